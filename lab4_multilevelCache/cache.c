@@ -1,34 +1,231 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAG_MATCH_X86  // vector tag match, picked at start-up (cache_tag_match_init)
+#endif
 
 #include "cache.h"
+#include "repl.h"
+
+#define SKEW_MIX 0x9e3779b97f4a7c15ULL  // odd multiplier for the skewed-way hashes
+
+// Which cache_find_way() runs, see there
+typedef enum Tag_Match_Enum {
+  TAG_MATCH_SCALAR,
+  TAG_MATCH_SSE41,
+  TAG_MATCH_AVX2,
+} Tag_Match;
 
+static Tag_Match tag_match = TAG_MATCH_SCALAR;
 
-extern uns64 cycle_count; // You can use this as timestamp for LRU
+// Runs once, before main(), so tag_match is only ever read afterwards
+// by the threads that create and access caches
+__attribute__((constructor))
+static void cache_tag_match_init(void){
+#ifdef TAG_MATCH_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")){
+    tag_match = TAG_MATCH_AVX2;
+  } else if(__builtin_cpu_supports("sse4.1")){
+    tag_match = TAG_MATCH_SSE41;
+  }
+#endif
+}
+
+Cache  *cache_new(uns64 size, uns64 assoc, uns64 linesize, uns64 repl_policy){
+  return cache_new_indexed(size, assoc, linesize, repl_policy, INDEX_MODULO);
+}
+
+// Largest prime <= n, by trial division: only done once per cache
+static uns64 cache_prime_below(uns64 n){
+  for(; n > 2; n--){
+    uns64 d = 2;
+    while(d * d <= n && n % d){
+      d++;
+    }
+    if(d * d > n){
+      return n;
+    }
+  }
+  return n;
+}
 
 ////////////////////////////////////////////////////////////////////
-// ------------- DO NOT MODIFY THE INIT FUNCTION -----------
+// Fully associative caches: a linear-probing table of the ways keyed
+// by tag, never more than half full, so a lookup takes a probe or two
+// however many ways there are. Empty ways are kept on a stack, and
+// LRU is a linked list rather than num_ways ranks to shift.
 ////////////////////////////////////////////////////////////////////
 
-Cache  *cache_new(uns64 size, uns64 assoc, uns64 linesize, uns64 repl_policy){
+static void cache_fa_init(Cache *c){
+  uns64 bits = 1;
+  while((1ULL << bits) < 2 * c->num_ways){
+    bits++;
+  }
+  c->fa_mask = (1ULL << bits) - 1;
+  c->fa_shift = 64 - bits;
+  c->fa_slot = (uns32 *) malloc ((c->fa_mask + 1) * sizeof(uns32));
+  memset(c->fa_slot, 0xff, (c->fa_mask + 1) * sizeof(uns32)); // every slot starts as FA_NO_WAY
+
+  // way 0 on top, so empty ways fill in order as in a scanned set
+  c->fa_free = (uns32 *) malloc (c->num_ways * sizeof(uns32));
+  for(uns64 i = 0; i < c->num_ways; i++){
+    c->fa_free[i] = c->num_ways - 1 - i;
+  }
+  c->fa_num_free = c->num_ways;
+
+  if(c->repl_policy == REPL_LRU){
+    c->fa_prev = (uns32 *) malloc (c->num_ways * sizeof(uns32));
+    c->fa_next = (uns32 *) malloc (c->num_ways * sizeof(uns32));
+    c->fa_head = c->fa_tail = FA_NO_WAY;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// The set index and tag split is fixed by the geometry, so compute
+// the mask and shift once here instead of on every access. Only a
+// power-of-two INDEX_MODULO cache drops the index bits from its tags;
+// every other index function keeps the whole line address.
+// assoc 0 makes the cache fully associative: one set of size/linesize
+// ways. All the lines live in one arena sized to the geometry.
+////////////////////////////////////////////////////////////////////
+
+Cache  *cache_new_indexed(uns64 size, uns64 assoc, uns64 linesize, uns64 repl_policy, uns64 index_fn){
 
    Cache *c = (Cache *) calloc (1, sizeof (Cache));
+   if(assoc == 0){
+     assoc = size/linesize;
+   }
    c->num_ways = assoc;
    c->repl_policy = repl_policy;
+   c->repl = repl_policy_get(repl_policy);
+   c->index_fn = index_fn;
+   c->num_sectors = 1;
+   c->sector_full = 1;
 
-   if(c->num_ways > MAX_WAYS){
-     printf("Change MAX_WAYS in cache.h to support %llu ways\n", c->num_ways);
+   if(index_fn >= NUM_INDEX_FNS){
+     printf("Unknown set-index function %llu\n", index_fn);
      exit(-1);
    }
 
    // determine num sets, and init the cache
-   c->num_sets = size/(linesize*assoc);
+   c->num_sets = assoc ? size/(linesize*assoc) : 0;
+
+   Flag pow2 = (c->num_sets & (c->num_sets - 1)) == 0;
+   if(c->num_sets == 0 || (!pow2 && (index_fn == INDEX_XOR || index_fn == INDEX_SKEW))){
+     printf("Number of sets (%llu) must be a power of two\n", c->num_sets);
+     exit(-1);
+   }
+   if(index_fn == INDEX_SKEW && (c->num_sets < 2 || repl_policy != REPL_LRU)){
+     printf("Skewed associativity needs at least 2 sets and LRU replacement\n");
+     exit(-1);
+   }
+
+   c->lines = (Cache_Line *) calloc (c->num_sets * c->num_ways, sizeof(Cache_Line));
    c->sets  = (Cache_Set *) calloc (c->num_sets, sizeof(Cache_Set));
+   for(uns64 s = 0; s < c->num_sets; s++){
+     c->sets[s].line = c->lines + s * c->num_ways;
+   }
+
+   if(pow2){
+     c->set_mask = c->num_sets - 1;
+     while((1ULL << c->index_bits) < c->num_sets){
+       c->index_bits++;
+     }
+   }
+   if(index_fn == INDEX_MODULO && pow2){
+     c->tag_shift = c->index_bits;
+   } else if(index_fn == INDEX_MODULO){
+     c->index_mod = c->num_sets;
+   } else if(index_fn == INDEX_PRIME){
+     c->index_mod = cache_prime_below(c->num_sets);
+   }
+   if(index_fn == INDEX_SKEW){
+     c->skew_stamp = (uns64 *) calloc (c->num_sets * c->num_ways, sizeof(uns64));
+   }
+
+   // pad each row so the tag match never needs a scalar tail loop
+   c->tag_stride = (assoc + TAG_MATCH_WIDTH - 1) / TAG_MATCH_WIDTH * TAG_MATCH_WIDTH;
+   uns64 tag_bytes = c->num_sets * c->tag_stride * sizeof(Addr);
+   c->tags = (Addr *) aligned_alloc(TAG_MATCH_WIDTH * sizeof(Addr), tag_bytes);
+   memset(c->tags, 0xff, tag_bytes); // every entry starts as INVALID_TAG
+   c->mru_way = (uns32 *) calloc (c->num_sets, sizeof(uns32));
+
+   if(c->num_sets == 1 && c->num_ways > FA_HASH_MIN_WAYS){
+     cache_fa_init(c);
+   }
+   if(c->fa_prev == NULL){
+     c->repl_state = c->repl->init(c->num_sets, c->num_ways);
+   }
 
    return c;
 }
 
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void cache_delete(Cache *c){
+  free(c->set_sampled);
+  free(c->set_read_miss);
+  free(c->set_write_miss);
+  if(c->threec){
+    threec_delete(c->threec);
+  }
+  free(c->way_pred_pc);
+  free(c->skew_stamp);
+  free(c->mru_way);
+  free(c->fa_slot);
+  free(c->fa_free);
+  free(c->fa_prev);
+  free(c->fa_next);
+  free(c->repl_state);
+  free(c->tags);
+  free(c->sets);
+  free(c->lines);
+  free(c);
+}
+
+////////////////////////////////////////////////////////////////////
+// Stats helpers for running one cache as several partial copies
+////////////////////////////////////////////////////////////////////
+
+void cache_clear_stats(Cache *c){
+  c->stat_read_access = 0;
+  c->stat_write_access = 0;
+  c->stat_read_miss = 0;
+  c->stat_write_miss = 0;
+  c->stat_dirty_evicts = 0;
+  c->stat_way_pred_hit = 0;
+  c->stat_way_pred_miss = 0;
+  memset(c->stat_threec_miss, 0, sizeof(c->stat_threec_miss));
+  c->stat_skipped_read = 0;
+  c->stat_skipped_write = 0;
+  c->stat_sector_miss = 0;
+  c->stat_dirty_sector_evicts = 0;
+}
+
+void cache_add_stats(Cache *dst, Cache *src){
+  dst->stat_read_access += src->stat_read_access;
+  dst->stat_write_access += src->stat_write_access;
+  dst->stat_read_miss += src->stat_read_miss;
+  dst->stat_write_miss += src->stat_write_miss;
+  dst->stat_dirty_evicts += src->stat_dirty_evicts;
+  dst->stat_way_pred_hit += src->stat_way_pred_hit;
+  dst->stat_way_pred_miss += src->stat_way_pred_miss;
+  for(uns k = 0; k < NUM_THREEC_CLASSES; k++){
+    dst->stat_threec_miss[k] += src->stat_threec_miss[k];
+  }
+  dst->stat_skipped_read += src->stat_skipped_read;
+  dst->stat_skipped_write += src->stat_skipped_write;
+  dst->stat_sector_miss += src->stat_sector_miss;
+  dst->stat_dirty_sector_evicts += src->stat_dirty_sector_evicts;
+}
+
 ////////////////////////////////////////////////////////////////////
 // ------------- DO NOT MODIFY THE PRINT STATS FUNCTION -----------
 ////////////////////////////////////////////////////////////////////
@@ -56,7 +253,420 @@ void    cache_print_stats    (Cache *c, char *header){
   printf("\n");
 }
 
+void cache_print_way_pred_stats(Cache *c, char *header){
+  uns64 hits = c->stat_way_pred_hit + c->stat_way_pred_miss;
+  double accuracy = 0;
+
+  if(hits){
+    accuracy = (double)(c->stat_way_pred_hit)/(double)(hits);
+  }
+
+  printf("\n%s_WAYPRED_HIT   \t\t : %10llu", header, c->stat_way_pred_hit);
+  printf("\n%s_WAYPRED_MISS  \t\t : %10llu", header, c->stat_way_pred_miss);
+  printf("\n%s_WAYPRED_ACCURACY\t : %10.3f", header, 100*accuracy);
+  printf("\n");
+}
+
+void cache_print_threec_stats(Cache *c, char *header){
+  printf("\n%s_COMPULSORY_MISS\t\t : %10llu", header, c->stat_threec_miss[THREEC_COMPULSORY]);
+  printf("\n%s_CAPACITY_MISS \t\t : %10llu", header, c->stat_threec_miss[THREEC_CAPACITY]);
+  printf("\n%s_CONFLICT_MISS \t\t : %10llu", header, c->stat_threec_miss[THREEC_CONFLICT]);
+  if(c->num_sectors > 1){
+    printf("\n%s_SECTOR_3C_MISS\t\t : %10llu", header, c->stat_threec_miss[THREEC_SECTOR]);
+  }
+  printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////
+// Miss classification: a shadow fully-associative LRU cache with
+// as many lines as this one, see threec.h
+////////////////////////////////////////////////////////////////////
+
+void cache_enable_threec(Cache *c){
+  if(c->threec == NULL){
+    c->threec = threec_new(c->num_sets * c->num_ways);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Set sampling: simulate num_sets/one_in sets, picked at random
+// (a fixed seed, so runs repeat) rather than by stride, so strided
+// access patterns cannot line up with the sample. The caller asks
+// cache_skip() before each access and leaves unsampled sets alone.
+////////////////////////////////////////////////////////////////////
+
+#define SAMPLE_SEED 0x2545f4914f6cdd1dULL
+
+void cache_enable_sampling(Cache *c, uns64 one_in){
+  if(one_in <= 1){
+    return;
+  }
+  if(c->index_fn == INDEX_SKEW){
+    printf("Set sampling needs a cache whose lines each map to one set, not a skewed one\n");
+    exit(-1);
+  }
+  if(one_in > c->num_sets){
+    printf("Cannot sample 1 in %llu of %llu sets\n", one_in, c->num_sets);
+    exit(-1);
+  }
+  c->num_sampled_sets = c->num_sets / one_in;
+  c->set_sampled = (Flag *) calloc (c->num_sets, sizeof(Flag));
+  c->set_read_miss = (uns64 *) calloc (c->num_sets, sizeof(uns64));
+  c->set_write_miss = (uns64 *) calloc (c->num_sets, sizeof(uns64));
+
+  // partial Fisher-Yates shuffle of the set numbers
+  uns64 *order = (uns64 *) malloc (c->num_sets * sizeof(uns64));
+  for(uns64 s = 0; s < c->num_sets; s++){
+    order[s] = s;
+  }
+  uns64 seed = SAMPLE_SEED;
+  for(uns64 i = 0; i < c->num_sampled_sets; i++){
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    uns64 j = i + seed % (c->num_sets - i);
+    uns64 tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+    c->set_sampled[order[i]] = TRUE;
+  }
+  free(order);
+}
+
+// TRUE if lineaddr maps to a set that is not simulated; the access
+// is then only counted
+Flag cache_skip(Cache *c, Addr lineaddr, uns mark_dirty){
+  if(c->set_sampled == NULL || c->set_sampled[cache_set_index(c, lineaddr)]){
+    return FALSE;
+  }
+  if(mark_dirty){
+    c->stat_skipped_write++;
+  } else {
+    c->stat_skipped_read++;
+  }
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////
+// Whole-cache misses estimated from the sampled sets, each with a
+// 95% confidence half-width: the sampled sets are a simple random
+// sample of all sets, so the total is num_sets times the per-set
+// mean, with the finite population correction on its variance
+////////////////////////////////////////////////////////////////////
+
+void cache_estimate_misses(Cache *c, Flag is_write, double *est, double *ci95){
+  uns64 *set_miss = is_write ? c->set_write_miss : c->set_read_miss;
+  uns64 n = c->num_sampled_sets;
+  double sum = 0;
+  double sumsq = 0;
+  for(uns64 s = 0; s < c->num_sets; s++){
+    if(c->set_sampled[s]){
+      sum += set_miss[s];
+      sumsq += (double) set_miss[s] * set_miss[s];
+    }
+  }
+  double mean = sum / n;
+  double var = (n > 1) ? (sumsq - n * mean * mean) / (n - 1) : 0;
+  double fpc = 1.0 - (double) n / c->num_sets;
+  *est = c->num_sets * mean;
+  *ci95 = 1.96 * c->num_sets * sqrt(var / n * fpc);
+}
+
+void cache_print_sampling_stats(Cache *c, char *header){
+  double read_miss, read_ci, write_miss, write_ci;
+  cache_estimate_misses(c, FALSE, &read_miss, &read_ci);
+  cache_estimate_misses(c, TRUE, &write_miss, &write_ci);
+
+  uns64 reads = c->stat_read_access + c->stat_skipped_read;
+  uns64 writes = c->stat_write_access + c->stat_skipped_write;
+  double read_mr = reads ? read_miss / reads : 0;
+  double write_mr = writes ? write_miss / writes : 0;
+
+  printf("\n%s_SAMPLED_SETS   \t\t : %10llu", header, c->num_sampled_sets);
+  printf("\n%s_EST_READ_ACCESS\t\t : %10llu", header, reads);
+  printf("\n%s_EST_WRITE_ACCESS\t\t : %10llu", header, writes);
+  printf("\n%s_EST_READ_MISS  \t\t : %10.0f +- %.0f", header, read_miss, read_ci);
+  printf("\n%s_EST_WRITE_MISS \t\t : %10.0f +- %.0f", header, write_miss, write_ci);
+  printf("\n%s_EST_READ_MISSPERC\t\t : %10.3f +- %.3f", header, 100*read_mr, reads ? 100*read_ci/reads : 0);
+  printf("\n%s_EST_WRITE_MISSPERC\t : %10.3f +- %.3f", header, 100*write_mr, writes ? 100*write_ci/writes : 0);
+  printf("\n");
+}
+
+void cache_print_sector_stats(Cache *c, char *header){
+  uns64 misses = c->stat_read_miss + c->stat_write_miss;
+
+  printf("\n%s_SECTORS        \t\t : %10llu", header, c->num_sectors);
+  printf("\n%s_LINE_MISS      \t\t : %10llu", header, misses - c->stat_sector_miss);
+  printf("\n%s_SECTOR_MISS    \t\t : %10llu", header, c->stat_sector_miss);
+  printf("\n%s_DIRTY_SECTOR_EVICTS\t : %10llu", header, c->stat_dirty_sector_evicts);
+  printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////
+// Way prediction is off unless turned on here, after cache_new()
+////////////////////////////////////////////////////////////////////
+
+void cache_set_way_pred(Cache *c, uns64 way_pred){
+  if(way_pred >= NUM_WAY_PRED_POLICIES){
+    printf("Unknown way prediction policy %llu\n", way_pred);
+    exit(-1);
+  }
+  if(way_pred != WAY_PRED_NONE && c->index_fn == INDEX_SKEW){
+    printf("Way prediction needs a cache whose lines each map to one set, not a skewed one\n");
+    exit(-1);
+  }
+  c->way_pred = way_pred;
+  if(way_pred == WAY_PRED_PC && c->way_pred_pc == NULL){
+    c->way_pred_pc = (uns32 *) calloc (WAY_PRED_PC_ENTRIES, sizeof(uns32));
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Sectored lines: one tag covers num_sectors sectors of the line,
+// each with its own valid and dirty bit. A miss to a resident line
+// (a sector miss) fills only that sector, evicting nothing. Set
+// after cache_new(), before the first access.
+////////////////////////////////////////////////////////////////////
+
+void cache_set_sectors(Cache *c, uns64 num_sectors){
+  if(num_sectors == 0 || num_sectors > MAX_SECTORS || (num_sectors & (num_sectors - 1))){
+    printf("Sectors per line (%llu) must be a power of two up to %d\n", num_sectors, MAX_SECTORS);
+    exit(-1);
+  }
+  c->num_sectors = num_sectors;
+  c->sector_full = (num_sectors == MAX_SECTORS) ? ~0u : (1u << num_sectors) - 1;
+}
+
+////////////////////////////////////////////////////////////////////
+// Set of lineaddr under the cache's index function. INDEX_XOR folds
+// the next two index-sized fields of the line address into the low
+// bits, so power-of-two strides spread over the sets; INDEX_PRIME
+// leaves the sets above the prime unused.
+////////////////////////////////////////////////////////////////////
+
+static inline uns64 cache_index(Cache *c, Addr lineaddr){
+  if (c->index_fn == INDEX_XOR) {
+    return (lineaddr ^ (lineaddr >> c->index_bits) ^ (lineaddr >> 2 * c->index_bits)) & c->set_mask;
+  }
+  return c->index_mod ? lineaddr % c->index_mod : lineaddr & c->set_mask;
+}
+
+// Skewed associativity: way 0 is indexed by the low bits, every
+// other way XORs in its own multiplicative hash of the bits above,
+// so lines that conflict in one way are scattered in the others
+static inline uns64 cache_skew_index(Cache *c, Addr lineaddr, uns way){
+  if (way == 0) {
+    return lineaddr & c->set_mask;
+  }
+  Addr high = lineaddr >> c->index_bits;
+  return (lineaddr ^ ((high * (SKEW_MIX * (2 * way + 1))) >> (64 - c->index_bits))) & c->set_mask;
+}
 
+// For a skewed cache, way 0's set: the other ways each have their own
+uns64 cache_set_index(Cache *c, Addr lineaddr){
+  return (c->index_fn == INDEX_SKEW) ? cache_skew_index(c, lineaddr, 0) : cache_index(c, lineaddr);
+}
+
+////////////////////////////////////////////////////////////////////
+// Compare tag against every way of the set, TAG_MATCH_WIDTH ways per
+// vector compare. Returns the first matching way, or -1 if none.
+// Searching for INVALID_TAG finds the first empty way. The AVX2 and
+// SSE4.1 versions are compiled for their target whatever the build
+// flags, and the best one the CPU runs is picked once, so a plain
+// -O2 build still matches tags in vectors.
+////////////////////////////////////////////////////////////////////
+
+#ifdef TAG_MATCH_X86
+__attribute__((target("avx2")))
+static int cache_find_way_avx2(const Addr *row, uns64 stride, Addr tag){
+  __m256i key = _mm256_set1_epi64x((long long) tag);
+  for (uns64 i = 0; i < stride; i += 4) {
+    __m256i ways = _mm256_load_si256((const __m256i *) (row + i));
+    int match = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(ways, key)));
+    if (match) {
+      return i + __builtin_ctz(match);
+    }
+  }
+  return -1;
+}
+
+__attribute__((target("sse4.1")))
+static int cache_find_way_sse41(const Addr *row, uns64 stride, Addr tag){
+  __m128i key = _mm_set1_epi64x((long long) tag);
+  for (uns64 i = 0; i < stride; i += 2) {
+    __m128i ways = _mm_load_si128((const __m128i *) (row + i));
+    int match = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(ways, key)));
+    if (match) {
+      return i + __builtin_ctz(match);
+    }
+  }
+  return -1;
+}
+#endif
+
+static int cache_find_way_scalar(const Addr *row, uns64 stride, Addr tag){
+  for (uns64 i = 0; i < stride; i++) {
+    if (row[i] == tag) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static inline int cache_find_way(Cache *c, uns64 set, Addr tag){
+  const Addr *row = c->tags + set * c->tag_stride;
+  int way;
+
+#ifdef TAG_MATCH_X86
+  if (tag_match == TAG_MATCH_AVX2) {
+    way = cache_find_way_avx2(row, c->tag_stride, tag);
+  } else if (tag_match == TAG_MATCH_SSE41) {
+    way = cache_find_way_sse41(row, c->tag_stride, tag);
+  } else
+#endif
+  {
+    way = cache_find_way_scalar(row, c->tag_stride, tag);
+  }
+
+  // padding slots hold INVALID_TAG too, they are never real ways
+  if (way >= (int) c->num_ways) {
+    way = -1;
+  }
+  return way;
+}
+
+////////////////////////////////////////////////////////////////////
+// The hash table of a fully associative cache (cache_fa_init). The
+// tag row is the only set's, so a way's tag is tags[way].
+////////////////////////////////////////////////////////////////////
+
+static inline uns64 cache_fa_home(Cache *c, Addr tag){
+  return (tag * SKEW_MIX) >> c->fa_shift;
+}
+
+static inline int cache_fa_find(Cache *c, Addr tag){
+  for (uns64 i = cache_fa_home(c, tag); c->fa_slot[i] != FA_NO_WAY; i = (i + 1) & c->fa_mask) {
+    if (c->tags[c->fa_slot[i]] == tag) {
+      return c->fa_slot[i];
+    }
+  }
+  return -1;
+}
+
+// After the way's tag is written
+static void cache_fa_add(Cache *c, uns way){
+  uns64 i = cache_fa_home(c, c->tags[way]);
+  while (c->fa_slot[i] != FA_NO_WAY) {
+    i = (i + 1) & c->fa_mask;
+  }
+  c->fa_slot[i] = way;
+}
+
+// Before the way's tag changes. Rather than leave a tombstone, later
+// entries of the probe run move back into the hole unless that would
+// put them before their home slot.
+static void cache_fa_remove(Cache *c, uns way){
+  uns64 hole = cache_fa_home(c, c->tags[way]);
+  while (c->fa_slot[hole] != way) {
+    hole = (hole + 1) & c->fa_mask;
+  }
+  for (uns64 i = (hole + 1) & c->fa_mask; c->fa_slot[i] != FA_NO_WAY; i = (i + 1) & c->fa_mask) {
+    uns64 home = cache_fa_home(c, c->tags[c->fa_slot[i]]);
+    if (((i - home) & c->fa_mask) >= ((i - hole) & c->fa_mask)) {
+      c->fa_slot[hole] = c->fa_slot[i];
+      hole = i;
+    }
+  }
+  c->fa_slot[hole] = FA_NO_WAY;
+}
+
+static void cache_fa_unlink(Cache *c, uns way){
+  uns32 prev = c->fa_prev[way];
+  uns32 next = c->fa_next[way];
+  if (prev == FA_NO_WAY) {
+    c->fa_head = next;
+  } else {
+    c->fa_next[prev] = next;
+  }
+  if (next == FA_NO_WAY) {
+    c->fa_tail = prev;
+  } else {
+    c->fa_prev[next] = prev;
+  }
+}
+
+static void cache_fa_push(Cache *c, uns way){
+  c->fa_prev[way] = FA_NO_WAY;
+  c->fa_next[way] = c->fa_head;
+  if (c->fa_head == FA_NO_WAY) {
+    c->fa_tail = way;
+  } else {
+    c->fa_prev[c->fa_head] = way;
+  }
+  c->fa_head = way;
+}
+
+////////////////////////////////////////////////////////////////////
+// Most hits are to the set's MRU way, so compare that one tag before
+// matching the whole row. Tags in a set are unique, so the answer is
+// the same as cache_find_way()'s, or the hash table's.
+////////////////////////////////////////////////////////////////////
+
+static inline int cache_lookup(Cache *c, uns64 set, Addr tag){
+  uns way = c->mru_way[set];
+  if (c->tags[set * c->tag_stride + way] == tag) {
+    return way;
+  }
+  return c->fa_slot ? cache_fa_find(c, tag) : cache_find_way(c, set, tag);
+}
+
+static inline uns64 cache_way_pred_slot(Addr pc){
+  return (pc ^ (pc >> 10)) & (WAY_PRED_PC_ENTRIES - 1);
+}
+
+static int cache_skew_lookup(Cache *c, Addr lineaddr, uns64 *set){
+  for (uns way = 0; way < c->num_ways; way++) {
+    uns64 s = cache_skew_index(c, lineaddr, way);
+    if (c->tags[s * c->tag_stride + way] == lineaddr) {
+      *set = s;
+      return way;
+    }
+  }
+  *set = 0;
+  return -1;
+}
+
+// Way holding lineaddr or -1, and in *set the set it was looked up in
+static inline int cache_locate(Cache *c, Addr lineaddr, uns64 *set){
+  if (c->skew_stamp) {
+    return cache_skew_lookup(c, lineaddr, set);
+  }
+  *set = cache_index(c, lineaddr);
+  return cache_lookup(c, *set, lineaddr >> c->tag_shift);
+}
+
+// Score the prediction for this access before the MRU way moves.
+// Misses are found by the parallel tag check and are not scored.
+static void cache_way_pred(Cache *c, uns64 set, int way, Addr lineaddr, Addr pc){
+  c->way_pred_slot = cache_way_pred_slot(pc);
+  c->way_pred_lineaddr = lineaddr;
+  if (way < 0) {
+    return;
+  }
+  uns predicted;
+  if (c->way_pred == WAY_PRED_PC) {
+    predicted = c->way_pred_pc[c->way_pred_slot];
+    c->way_pred_pc[c->way_pred_slot] = way;
+  } else {
+    predicted = c->mru_way[set];
+  }
+  c->last_way_mispredict = (predicted != (uns) way);
+  if (c->last_way_mispredict) {
+    c->stat_way_pred_miss++;
+  } else {
+    c->stat_way_pred_hit++;
+  }
+}
 
 ////////////////////////////////////////////////////////////////////
 // Note: the system provides the cache with the line address
@@ -65,102 +675,294 @@ void    cache_print_stats    (Cache *c, char *header){
 // Update appropriate stats
 ////////////////////////////////////////////////////////////////////
 
-#include <assert.h>
-#include <tgmath.h>
-int get_bits(int value, int start, int end) {
-  int result;
-  assert(start >= end);
-  result = value >> end;
-  result = result % (1 << (start - end + 1));
-  return result;
+Flag cache_access(Cache *c, Addr lineaddr, uns mark_dirty){
+  return cache_access_pc(c, lineaddr, mark_dirty, 0);
 }
 
-Flag cache_access(Cache *c, Addr lineaddr, uns mark_dirty){
+// pc trains the WAY_PRED_PC predictor, 0 if unknown
+Flag cache_access_pc(Cache *c, Addr lineaddr, uns mark_dirty, Addr pc){
+  return cache_access_sector(c, lineaddr, 0, mark_dirty, pc);
+}
+
+// Replacement update for a use of (set, way)
+static inline void cache_touch(Cache *c, uns64 set, int way){
+  if (c->skew_stamp) {
+    c->skew_stamp[set * c->num_ways + way] = ++c->skew_clock;
+  } else if (c->fa_prev) {
+    if (c->fa_head != (uns32) way) {
+      cache_fa_unlink(c, way);
+      cache_fa_push(c, way);
+    }
+  } else {
+    c->repl->hit(c, set, way);
+  }
+  c->mru_way[set] = way;
+}
+
+// An access to one sector of the line; sector is 0 when not sectored.
+// A sector miss still counts as a use of the line for replacement.
+Flag cache_access_sector(Cache *c, Addr lineaddr, uns sector, uns mark_dirty, Addr pc){
   if (mark_dirty) {
     c->stat_write_access = c->stat_write_access + 1;
   } else {
     c->stat_read_access = c->stat_read_access + 1;
   }
-  Flag outcome = MISS;
-  int bit6 = get_bits(lineaddr, (log2(c->num_sets) - 1) , 0);
-  for(uns64 i = 0; i < c->num_ways; i++) {
-    if (lineaddr == (c->sets[bit6]).line[i].tag) {
-      outcome = HIT;
-      c->sets[bit6].line[i].last_access_time = cycle_count;
-      if (mark_dirty){
-        c->sets[bit6].line[i].dirty = TRUE;
-      }
-    break;
+  uns64 set;
+  int way = cache_locate(c, lineaddr, &set);
+  c->last_way_mispredict = FALSE;
+  if (c->way_pred) {
+    cache_way_pred(c, set, way, lineaddr, pc);
+  }
+  uns32 bit = 1u << sector;
+  Flag sector_miss = (way >= 0 && !(c->sets[set].line[way].sector_valid & bit));
+  if (c->threec) {
+    Three_C_Class cls = threec_access(c->threec, lineaddr);
+    if (way < 0) {
+      c->stat_threec_miss[cls]++;
+    } else if (sector_miss) {
+      c->stat_threec_miss[THREEC_SECTOR]++;
     }
   }
-  if (outcome == MISS){
+  if (way < 0 || sector_miss) {
     if (mark_dirty) {
       c->stat_write_miss = c->stat_write_miss + 1;
     } else {
       c->stat_read_miss = c->stat_read_miss + 1;
     }
+    if (c->set_sampled) {
+      (mark_dirty ? c->set_write_miss : c->set_read_miss)[set]++;
+    }
+    if (sector_miss) {
+      c->stat_sector_miss++;
+      cache_touch(c, set, way);
+    }
+    return MISS;
+  }
+  cache_touch(c, set, way);
+  if (mark_dirty){
+    c->sets[set].line[way].dirty = TRUE;
+    c->sets[set].line[way].sector_dirty |= bit;
+  }
+  c->last_hit_prefetched = c->sets[set].line[way].prefetched;
+  c->sets[set].line[way].prefetched = FALSE;
+  return HIT;
+}
+
+////////////////////////////////////////////////////////////////////
+// Lookup with no side effects: no stats, no replacement update
+////////////////////////////////////////////////////////////////////
+
+Flag cache_probe(Cache *c, Addr lineaddr){
+  uns64 set;
+  return cache_locate(c, lineaddr, &set) >= 0 ? HIT : MISS;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Drop lineaddr if present, for back-invalidation and exclusive
+// hierarchies. Returns HIT if it was there, with its dirty bit in
+// *dirty. No stats, and last_evicted_line is left alone.
+////////////////////////////////////////////////////////////////////
+
+Flag cache_invalidate(Cache *c, Addr lineaddr, Flag *dirty){
+  uns64 set;
+  int way = cache_locate(c, lineaddr, &set);
+  *dirty = FALSE;
+  if (way < 0) {
+    return MISS;
+  }
+  *dirty = c->sets[set].line[way].dirty;
+  c->sets[set].line[way].valid = FALSE;
+  c->sets[set].line[way].dirty = FALSE;
+  c->sets[set].line[way].prefetched = FALSE;
+  if (c->fa_slot) {
+    cache_fa_remove(c, way);
+    if (c->fa_prev) {
+      cache_fa_unlink(c, way);
+    }
+    c->fa_free[c->fa_num_free++] = way;
+  }
+  c->tags[set * c->tag_stride + way] = INVALID_TAG;
+  return HIT;
+}
+
+// The line holding lineaddr, or NULL, for callers that keep state
+// of their own in it (coherence). No stats, no replacement update.
+Cache_Line *cache_find_line(Cache *c, Addr lineaddr){
+  uns64 set;
+  int way = cache_locate(c, lineaddr, &set);
+  return (way >= 0) ? &c->sets[set].line[way] : NULL;
+}
+
+void cache_mark_dirty(Cache *c, Addr lineaddr){
+  uns64 set;
+  int way = cache_locate(c, lineaddr, &set);
+  if (way >= 0) {
+    c->sets[set].line[way].dirty = TRUE;
+    c->sets[set].line[way].sector_dirty |= c->sets[set].line[way].sector_valid;
   }
-  return outcome;
 }
 
 
 ////////////////////////////////////////////////////////////////////
 // Note: the system provides the cache with the line address
-// Install the line: determine victim using repl policy (LRU/RAND)
+// Install the line: fill an empty way if there is one, otherwise the
+// way chosen by the replacement policy
 // copy victim into last_evicted_line for tracking writebacks
 ////////////////////////////////////////////////////////////////////
 
-void cache_install(Cache *c, Addr lineaddr, uns mark_dirty){
-
-  int bit6 = get_bits(lineaddr, (log2(c->num_sets) - 1), 0);
-  int checkSpace = FALSE;
-  for (uns64 i = 0; i < c->num_ways; i++) {
-    if (c->sets[bit6].line[i].tag == 0) {
-      c->sets[bit6].line[i].dirty = mark_dirty;
-      c->sets[bit6].line[i].last_access_time = cycle_count;
-      c->sets[bit6].line[i].tag = lineaddr;
-      c->sets[bit6].line[i].valid = TRUE;
-      checkSpace = TRUE;
-      break;
-    }
-  }
-  if (checkSpace == FALSE) {
-    if (c->repl_policy) {
-      int randNum = rand() % c->num_ways;
-      c->last_evicted_line = c->sets[bit6].line[randNum];
-      c->sets[bit6].line[randNum].dirty = mark_dirty;
-      c->sets[bit6].line[randNum].last_access_time = cycle_count;
-      c->sets[bit6].line[randNum].tag = lineaddr;
-      c->sets[bit6].line[randNum].valid = TRUE;
-      if (c->sets[bit6].line[randNum].dirty) {
-        c->stat_dirty_evicts++;
+// Skewed caches pick among each way's candidate set: the first empty
+// one, else the least recently used
+static int cache_skew_victim(Cache *c, Addr lineaddr, uns64 *set){
+  int victim = 0;
+  uns64 oldest = ~0ULL;
+  *set = cache_skew_index(c, lineaddr, 0);
+  for (uns way = 0; way < c->num_ways; way++) {
+    uns64 s = cache_skew_index(c, lineaddr, way);
+    uns64 stamp = c->sets[s].line[way].valid ? c->skew_stamp[s * c->num_ways + way] : 0;
+    if (stamp < oldest) {
+      oldest = stamp;
+      victim = way;
+      *set = s;
+      if (stamp == 0) {
+        break;
       }
+    }
+  }
+  return victim;
+}
+
+static void cache_fill(Cache *c, Addr lineaddr, uns mark_dirty, Flag prefetched, uns32 sectors){
+
+  uns64 set;
+  int way;
+  Flag empty;
+  if (c->skew_stamp) {
+    way = cache_skew_victim(c, lineaddr, &set);
+    empty = !c->sets[set].line[way].valid;
+  } else if (c->fa_slot) {
+    set = 0;
+    empty = (c->fa_num_free > 0);
+    if (empty) {
+      way = c->fa_free[--c->fa_num_free];
     } else {
-      uns64 min = 0;
-      int cacheBlock = 0;
-      for (uns64 i = 0; i < c->num_ways; i++) {
-        if (i == 0) {
-          min = c->sets[bit6].line[i].last_access_time;
-          cacheBlock = i;
-        }
-        if (min > c->sets[bit6].line[i].last_access_time) {
-          min = c->sets[bit6].line[i].last_access_time;
-          cacheBlock = i;
-        }
-      }
-      if (c->sets[bit6].line[cacheBlock].dirty){
-        c->stat_dirty_evicts++;
-      }
-      c->last_evicted_line = c->sets[bit6].line[cacheBlock];
-      c->sets[bit6].line[cacheBlock].dirty = mark_dirty;
-      c->sets[bit6].line[cacheBlock].last_access_time = cycle_count;
-      c->sets[bit6].line[cacheBlock].tag = lineaddr;
-      c->sets[bit6].line[cacheBlock].valid = TRUE;
+      way = c->fa_prev ? c->fa_tail : c->repl->victim(c, set);
+      cache_fa_remove(c, way);
+    }
+  } else {
+    set = cache_index(c, lineaddr);
+    way = cache_find_way(c, set, INVALID_TAG);
+    empty = (way >= 0);
+    if (!empty) {
+      way = c->repl->victim(c, set);
     }
   }
+  if (empty) {
+    c->last_evicted_line.valid = FALSE;
+  } else {
+    c->last_evicted_line = c->sets[set].line[way];
+  }
+  c->sets[set].line[way].dirty = mark_dirty;
+  c->sets[set].line[way].sector_valid = sectors;
+  c->sets[set].line[way].sector_dirty = mark_dirty ? sectors : 0;
+  c->sets[set].line[way].prefetched = prefetched;
+  c->sets[set].line[way].tag = lineaddr;
+  c->sets[set].line[way].valid = TRUE;
+  c->tags[set * c->tag_stride + way] = lineaddr >> c->tag_shift;
+  if (c->fa_slot) {
+    cache_fa_add(c, way);
+  }
+  if (c->skew_stamp) {
+    c->skew_stamp[set * c->num_ways + way] = ++c->skew_clock;
+  } else if (c->fa_prev) {
+    if (!empty) {
+      cache_fa_unlink(c, way);
+    }
+    cache_fa_push(c, way);
+  } else {
+    c->repl->insert(c, set, way);
+  }
+  c->mru_way[set] = way;
+  if (c->way_pred == WAY_PRED_PC && !prefetched && c->way_pred_lineaddr == lineaddr) {
+    c->way_pred_pc[c->way_pred_slot] = way;
+  }
+}
+
+// Count the victim of the fill just made, if it was dirty
+static void cache_count_evict(Cache *c){
+  if (c->last_evicted_line.valid && c->last_evicted_line.dirty) {
+    c->stat_dirty_evicts++;
+    c->stat_dirty_sector_evicts += __builtin_popcount(c->last_evicted_line.sector_dirty);
+  }
+}
+
+// If the rest of the line is resident (a sector miss) the sector
+// joins it and nothing is evicted, else the line is filled with only
+// this sector
+static void cache_place_sector(Cache *c, Addr lineaddr, uns sector, uns mark_dirty){
+  uns32 bit = 1u << sector;
+  Cache_Line *line = (c->num_sectors > 1) ? cache_find_line(c, lineaddr) : NULL;
+  if (line == NULL) {
+    cache_fill(c, lineaddr, mark_dirty, FALSE, (c->num_sectors > 1) ? bit : c->sector_full);
+    return;
+  }
+  line->sector_valid |= bit;
+  if (mark_dirty) {
+    line->dirty = TRUE;
+    line->sector_dirty |= bit;
+  }
+  c->last_evicted_line.valid = FALSE;
+}
+
+void cache_install(Cache *c, Addr lineaddr, uns mark_dirty){
+  cache_fill(c, lineaddr, mark_dirty, FALSE, c->sector_full);
+  cache_count_evict(c);
+}
+
+// Install a clean line brought in by a prefetcher
+void cache_install_prefetch(Cache *c, Addr lineaddr){
+  cache_fill(c, lineaddr, FALSE, TRUE, c->sector_full);
+  cache_count_evict(c);
+}
+
+// Install one sector after a miss to it
+void cache_install_sector(Cache *c, Addr lineaddr, uns sector, uns mark_dirty){
+  cache_place_sector(c, lineaddr, sector, mark_dirty);
+  cache_count_evict(c);
 }
 
 ////////////////////////////////////////////////////////////////////
+// Functional access for warmup: the lookup and, on a miss, the fill
+// of a timed access, with the same replacement updates, but no stats,
+// way prediction or sampling. The miss classifier's shadow cache and
+// first-touch set see the access too, without counting it, so lines
+// touched during warmup are not later taken for compulsory misses.
+// The victim, if any, is left in last_evicted_line.
 ////////////////////////////////////////////////////////////////////
 
+Flag cache_warm(Cache *c, Addr lineaddr, uns sector, uns mark_dirty){
+  uns64 set;
+  int way = cache_locate(c, lineaddr, &set);
+  if (c->threec) {
+    threec_access(c->threec, lineaddr);
+  }
+  if (way < 0) {
+    cache_place_sector(c, lineaddr, sector, mark_dirty);
+    return MISS;
+  }
+  cache_touch(c, set, way);
+  Cache_Line *line = &c->sets[set].line[way];
+  if (!(line->sector_valid & (1u << sector))) {
+    cache_place_sector(c, lineaddr, sector, mark_dirty);
+    return MISS;
+  }
+  if (mark_dirty) {
+    line->dirty = TRUE;
+    line->sector_dirty |= 1u << sector;
+  }
+  line->prefetched = FALSE;
+  return HIT;
+}
 
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,182 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "types.h"
+#include "threec.h"
+
+// Tag-array entry for an empty way (and for the padding after the last way).
+// A real tag is lineaddr >> tag_shift, which never has all bits set.
+#define INVALID_TAG (~(Addr)0)
+
+// Ways are compared this many at a time, so each set's tag row is padded
+// to a multiple of it (4 x 64-bit tags = one 256-bit compare).
+#define TAG_MATCH_WIDTH 4
+
+// A cache of one set with more ways than this (fully associative, see
+// cache_new_indexed) finds its lines through a hash table of tags
+// instead of comparing the whole row
+#define FA_HASH_MIN_WAYS 32
+#define FA_NO_WAY (~(uns32)0)  // empty hash slot, end of the FA LRU list
+
+//////////////////////////////////////////////////////////////
+// Way prediction (L1s). Tags are still checked in all ways at once,
+// but only the predicted way's data is read; a hit in another way
+// reads the data a second time and is reported as a mispredict.
+//////////////////////////////////////////////////////////////
+
+typedef enum Way_Pred_Enum {
+  WAY_PRED_NONE,  // read every way's data in parallel
+  WAY_PRED_MRU,   // the set's most recently used way
+  WAY_PRED_PC,    // the way the same PC last hit or filled
+  NUM_WAY_PRED_POLICIES
+} Way_Pred_Policy;
+
+#define WAY_PRED_PC_ENTRIES 1024 // PC-indexed predictor table, power of two
+
+//////////////////////////////////////////////////////////////
+// Set-index functions, selected by cache_new_indexed(). Caches with
+// anything but a power-of-two INDEX_MODULO keep the whole line
+// address as the tag.
+//////////////////////////////////////////////////////////////
+
+typedef enum Index_Fn_Enum {
+  INDEX_MODULO,  // lineaddr mod num_sets: the low bits for a power of two
+  INDEX_XOR,     // low bits XOR the next two fields of as many bits
+  INDEX_PRIME,   // lineaddr mod the largest prime <= num_sets
+  INDEX_SKEW,    // skewed-associative: each way hashes differently
+  NUM_INDEX_FNS
+} Index_Fn;
+
+#define MAX_SECTORS 32  // sectors per line, one bit each in the sector masks
+
+typedef struct Cache_Line Cache_Line;
+typedef struct Cache_Set Cache_Set;
+typedef struct Cache Cache;
+typedef struct Repl_Policy Repl_Policy;
+
+//////////////////////////////////////////////////////////////
+// Define the Data structures here with the correct field (Refer to Appendix B for more details)
+//////////////////////////////////////////////////////////////
+
+struct Cache_Line {
+    Flag    valid;
+    Flag    dirty;
+    Flag    prefetched; // filled by a prefetch, no demand hit yet
+    Addr    tag;
+    uns32   sector_valid; // sectors present (every bit when not sectored)
+    uns32   sector_dirty; // sectors written since the fill
+    // Note: recency/frequency state lives with the replacement policy
+    // Note: No data as we are only estimating hit/miss
+};
+
+
+struct Cache_Set {
+    Cache_Line *line; // num_ways cache lines, this set's row of the cache's line arena
+};
+
+
+struct Cache{
+  uns64 num_sets; // Number of sets
+  uns64 num_ways; // Number of ways within a set
+  uns64 repl_policy; // Replacement policy
+  const Repl_Policy *repl; // Hooks for repl_policy, see repl.h
+  void *repl_state;        // Per-set state owned by the policy
+
+  uns64 index_fn;   // Index_Fn
+  uns64 index_bits; // log2(num_sets) when a power of two
+  uns64 index_mod;  // modulo/prime: the divisor; 0 = lineaddr & set_mask
+  uns64 set_mask;   // num_sets-1 when a power of two
+  uns64 tag_shift;  // tag is lineaddr >> tag_shift (0 = the whole line address)
+  uns64 *skew_stamp; // INDEX_SKEW: last use of each line, for LRU among the candidates
+  uns64 skew_clock;
+  uns64 tag_stride; // Tags per set in the tag array (num_ways, padded)
+  Addr *tags;       // num_sets*tag_stride tags, one contiguous row per set
+  uns32 *mru_way;   // most recently used way of each set, compared first
+
+  uns64 num_sectors;  // sectors per line, 1 = not sectored; see cache_set_sectors()
+  uns32 sector_full;  // sector_valid of a whole line
+
+  uns64 way_pred;     // Way_Pred_Policy
+  uns32 *way_pred_pc; // WAY_PRED_PC: predicted way per PC slot
+  uns64 way_pred_slot;     // PC slot of the last access ...
+  Addr  way_pred_lineaddr; // ... and the line it missed on, trained by its fill
+
+  Three_C *threec;  // miss classification, NULL unless enabled
+
+  // set sampling: only sets with set_sampled[set] are simulated,
+  // NULL = all of them; see cache_enable_sampling()
+  Flag  *set_sampled;
+  uns64  num_sampled_sets;
+  uns64 *set_read_miss;   // [set] misses, for the confidence intervals
+  uns64 *set_write_miss;
+
+  // fully associative caches of more than FA_HASH_MIN_WAYS ways: a
+  // linear-probing table of ways keyed by tag, a stack of the empty
+  // ways and, for LRU, a recency list in place of the policy's state.
+  // fa_slot is NULL for every other cache.
+  uns32 *fa_slot;     // way in each slot, FA_NO_WAY when empty
+  uns64  fa_mask;     // slots-1
+  uns64  fa_shift;    // a tag's home slot is its hash >> fa_shift
+  uns32 *fa_free;     // empty ways, the next fill takes the top one
+  uns64  fa_num_free;
+  uns32 *fa_prev;     // LRU list, MRU first; NULL unless REPL_LRU
+  uns32 *fa_next;
+  uns32  fa_head;
+  uns32  fa_tail;
+
+  Cache_Line *lines; // num_sets*num_ways lines, set by set
+  Cache_Set *sets; // Array of Cache_Set, each a row of lines
+  Cache_Line last_evicted_line; // Stores the last evicted line
+  Flag last_hit_prefetched; // The last hit was the first demand hit to a prefetched line
+  Flag last_way_mispredict; // The last access hit a way other than the predicted one
+
+  //stats
+  uns64 stat_read_access; // Number of read (lookup accesses do not count as READ accesses) accesses made to the cache
+  uns64 stat_write_access; // Number of write accesses made to the cache
+  uns64 stat_read_miss; // Number of read misses
+  uns64 stat_write_miss; // Number of write misses
+  uns64 stat_dirty_evicts; // Number of dirty evictions
+  uns64 stat_way_pred_hit;  // hits in the predicted way
+  uns64 stat_way_pred_miss; // hits in another way
+  uns64 stat_threec_miss[NUM_THREEC_CLASSES]; // read and write misses by Three_C_Class
+  uns64 stat_skipped_read;  // accesses to sets that are not sampled
+  uns64 stat_skipped_write;
+  uns64 stat_sector_miss;  // misses to a resident line whose sector was not there
+  uns64 stat_dirty_sector_evicts;
+};
+
+//////////////////////////////////////////////////////////////
+// Mandatory variables required for generating the desired final reports as necessary
+// Used by sim.cpp
+//////////////////////////////////////////////////////////////
+
+Cache  *cache_new(uns64 size, uns64 assocs, uns64 linesize, uns64 repl_policy);
+Cache  *cache_new_indexed(uns64 size, uns64 assocs, uns64 linesize, uns64 repl_policy, uns64 index_fn);
+uns64   cache_set_index(Cache *c, Addr lineaddr);
+void    cache_delete(Cache *c);
+Flag    cache_access (Cache *c, Addr lineaddr, uns mark_dirty);
+Flag    cache_access_pc(Cache *c, Addr lineaddr, uns mark_dirty, Addr pc);
+Flag    cache_access_sector(Cache *c, Addr lineaddr, uns sector, uns mark_dirty, Addr pc);
+void    cache_set_sectors(Cache *c, uns64 num_sectors);
+void    cache_set_way_pred(Cache *c, uns64 way_pred);
+void    cache_enable_threec(Cache *c);
+void    cache_enable_sampling(Cache *c, uns64 one_in);
+Flag    cache_skip(Cache *c, Addr lineaddr, uns mark_dirty);
+void    cache_estimate_misses(Cache *c, Flag is_write, double *est, double *ci95);
+void    cache_install(Cache *c, Addr lineaddr, uns mark_dirty);
+void    cache_install_prefetch(Cache *c, Addr lineaddr);
+void    cache_install_sector(Cache *c, Addr lineaddr, uns sector, uns mark_dirty);
+Flag    cache_warm(Cache *c, Addr lineaddr, uns sector, uns mark_dirty);
+Flag    cache_probe(Cache *c, Addr lineaddr);
+Flag    cache_invalidate(Cache *c, Addr lineaddr, Flag *dirty);
+void    cache_mark_dirty(Cache *c, Addr lineaddr);
+Cache_Line *cache_find_line(Cache *c, Addr lineaddr);
+void    cache_print_stats    (Cache *c, char *header);
+void    cache_print_way_pred_stats(Cache *c, char *header);
+void    cache_print_threec_stats(Cache *c, char *header);
+void    cache_print_sampling_stats(Cache *c, char *header);
+void    cache_print_sector_stats(Cache *c, char *header);
+void    cache_clear_stats(Cache *c);
+void    cache_add_stats(Cache *dst, Cache *src);
+
+#endif // CACHE_H
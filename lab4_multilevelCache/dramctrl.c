@@ -0,0 +1,226 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dramctrl.h"
+
+////////////////////////////////////////////////////////////////////
+// Defaults: one channel, one rank of 16 banks with 1KB rows, and
+// ACT/CAS/PRE of 45 cycles each plus a 10-cycle burst
+////////////////////////////////////////////////////////////////////
+
+void dramctrl_config_default(DRAM_Config *cfg){
+  memset(cfg, 0, sizeof(DRAM_Config));
+  cfg->model = DRAM_MODEL_FLAT;
+  cfg->channels = 1;
+  cfg->ranks = 1;
+  cfg->banks = 16;
+  cfg->row_bytes = 1024;
+  cfg->page_policy = DRAM_PAGE_OPEN;
+  cfg->t_rcd = 45;
+  cfg->t_cas = 45;
+  cfg->t_rp = 45;
+  cfg->t_burst = 10;
+  cfg->write_queue = 32;
+}
+
+DRAM_Ctrl *dramctrl_new(DRAM_Config *cfg, uns64 linesize){
+  if(cfg->channels == 0 || cfg->ranks == 0 || cfg->banks == 0 || cfg->row_bytes < linesize
+     || cfg->page_policy >= NUM_DRAM_PAGE_POLICIES || cfg->write_queue == 0){
+    printf("Bad DRAM configuration\n");
+    exit(-1);
+  }
+
+  DRAM_Ctrl *d = (DRAM_Ctrl *) calloc (1, sizeof (DRAM_Ctrl));
+  d->cfg = *cfg;
+  d->lines_per_row = cfg->row_bytes / linesize;
+  d->bank = (DRAM_Bank *) calloc (cfg->channels * cfg->ranks * cfg->banks, sizeof(DRAM_Bank));
+  d->bus_free = (uns64 *) calloc (cfg->channels, sizeof(uns64));
+  d->wq = (DRAM_Write *) calloc (cfg->write_queue, sizeof(DRAM_Write));
+  return d;
+}
+
+void dramctrl_delete(DRAM_Ctrl *d){
+  free(d->wq);
+  free(d->bus_free);
+  free(d->bank);
+  free(d);
+}
+
+////////////////////////////////////////////////////////////////////
+// row:rank:bank:column:channel
+////////////////////////////////////////////////////////////////////
+
+static DRAM_Bank *dramctrl_bank(DRAM_Ctrl *d, Addr lineaddr, uns64 *channel, uns64 *row){
+  uns64 x = lineaddr;
+  *channel = x % d->cfg.channels;
+  x /= d->cfg.channels;
+  x /= d->lines_per_row;
+  uns64 bank = x % d->cfg.banks;
+  x /= d->cfg.banks;
+  uns64 rank = x % d->cfg.ranks;
+  *row = x / d->cfg.ranks;
+  return &d->bank[(*channel * d->cfg.ranks + rank) * d->cfg.banks + bank];
+}
+
+static Flag dramctrl_row_hit(DRAM_Ctrl *d, Addr lineaddr){
+  uns64 channel, row;
+  DRAM_Bank *b = dramctrl_bank(d, lineaddr, &channel, &row);
+  return b->row_open && b->open_row == row;
+}
+
+////////////////////////////////////////////////////////////////////
+// Issue one access no earlier than cycle t, returns the cycle its
+// data transfer completes
+////////////////////////////////////////////////////////////////////
+
+static uns64 dramctrl_issue(DRAM_Ctrl *d, Addr lineaddr, uns64 t){
+  uns64 channel, row;
+  DRAM_Bank *b = dramctrl_bank(d, lineaddr, &channel, &row);
+  uns64 start = t;
+  uns64 latency;
+
+  if(b->ready > t){
+    d->stat_bank_conflict++;
+    start = b->ready;
+  }
+
+  if(b->row_open && b->open_row == row){
+    d->stat_row_hit++;
+    latency = d->cfg.t_cas;
+  } else if(b->row_open){
+    d->stat_row_conflict++;
+    latency = d->cfg.t_rp + d->cfg.t_rcd + d->cfg.t_cas;
+  } else {
+    d->stat_row_miss++;
+    latency = d->cfg.t_rcd + d->cfg.t_cas;
+  }
+
+  uns64 data = start + latency;
+  if(data < d->bus_free[channel]){
+    data = d->bus_free[channel];
+  }
+  uns64 done = data + d->cfg.t_burst;
+  d->bus_free[channel] = done;
+
+  if(d->cfg.page_policy == DRAM_PAGE_OPEN){
+    b->row_open = TRUE;
+    b->open_row = row;
+    b->ready = start + latency;
+  } else {
+    b->row_open = FALSE;
+    b->ready = start + latency + d->cfg.t_rp;
+  }
+  return done;
+}
+
+////////////////////////////////////////////////////////////////////
+// Write queue, oldest first
+////////////////////////////////////////////////////////////////////
+
+static void dramctrl_issue_write(DRAM_Ctrl *d, uns64 i, uns64 t){
+  if(t < d->wq[i].arrival){
+    t = d->wq[i].arrival;
+  }
+  dramctrl_issue(d, d->wq[i].lineaddr, t);
+  memmove(&d->wq[i], &d->wq[i + 1], (d->wq_len - i - 1) * sizeof(DRAM_Write));
+  d->wq_len--;
+}
+
+// FR-FCFS: the oldest row hit, or else the oldest write
+static uns64 dramctrl_pick_write(DRAM_Ctrl *d){
+  for(uns64 i = 0; i < d->wq_len; i++){
+    if(dramctrl_row_hit(d, d->wq[i].lineaddr)){
+      return i;
+    }
+  }
+  return 0;
+}
+
+// Before a read at cycle now: writes that hit an open row in a bank
+// that is idle by then go first, using otherwise idle bank time
+static void dramctrl_drain_idle(DRAM_Ctrl *d, Addr read_lineaddr, uns64 now){
+  uns64 read_channel, read_row;
+  DRAM_Bank *read_bank = dramctrl_bank(d, read_lineaddr, &read_channel, &read_row);
+
+  uns64 i = 0;
+  while(i < d->wq_len){
+    uns64 channel, row;
+    DRAM_Bank *b = dramctrl_bank(d, d->wq[i].lineaddr, &channel, &row);
+    if(b != read_bank && b->ready <= now && b->row_open && b->open_row == row){
+      dramctrl_issue_write(d, i, b->ready);
+    } else {
+      i++;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Returns the read latency; writes are queued and return 0
+////////////////////////////////////////////////////////////////////
+
+uns64 dramctrl_access(DRAM_Ctrl *d, Addr lineaddr, Flag is_write, uns64 now){
+  if(is_write){
+    d->stat_write_access++;
+    if(d->wq_len == d->cfg.write_queue){
+      d->stat_write_drain++;
+      while(d->wq_len > d->cfg.write_queue / 2){
+        dramctrl_issue_write(d, dramctrl_pick_write(d), now);
+      }
+    }
+    d->wq[d->wq_len].lineaddr = lineaddr;
+    d->wq[d->wq_len].arrival = now;
+    d->wq_len++;
+    return 0;
+  }
+
+  dramctrl_drain_idle(d, lineaddr, now);
+
+  uns64 delay = dramctrl_issue(d, lineaddr, now) - now;
+  d->stat_read_access++;
+  d->stat_read_delay += delay;
+  return delay;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void dramctrl_clear_stats(DRAM_Ctrl *d){
+  d->stat_read_access = 0;
+  d->stat_write_access = 0;
+  d->stat_read_delay = 0;
+  d->stat_row_hit = 0;
+  d->stat_row_miss = 0;
+  d->stat_row_conflict = 0;
+  d->stat_bank_conflict = 0;
+  d->stat_write_drain = 0;
+}
+
+void dramctrl_print_stats(DRAM_Ctrl *d){
+  char header[256];
+  sprintf(header, "DRAM");
+
+  uns64 accesses = d->stat_row_hit + d->stat_row_miss + d->stat_row_conflict;
+  double row_hit_rate = 0;
+  double read_delay_avg = 0;
+
+  if(accesses){
+    row_hit_rate = (double)(d->stat_row_hit)/(double)(accesses);
+  }
+  if(d->stat_read_access){
+    read_delay_avg = (double)(d->stat_read_delay)/(double)(d->stat_read_access);
+  }
+
+  printf("\n");
+  printf("\n%s_READ_ACCESS    \t\t : %10llu", header, d->stat_read_access);
+  printf("\n%s_WRITE_ACCESS   \t\t : %10llu", header, d->stat_write_access);
+  printf("\n%s_READ_AVGDELAY  \t\t : %10.3f", header, read_delay_avg);
+  printf("\n%s_ROW_HIT        \t\t : %10llu", header, d->stat_row_hit);
+  printf("\n%s_ROW_MISS       \t\t : %10llu", header, d->stat_row_miss);
+  printf("\n%s_ROW_CONFLICT   \t\t : %10llu", header, d->stat_row_conflict);
+  printf("\n%s_ROW_HITPERC    \t\t : %10.3f", header, 100*row_hit_rate);
+  printf("\n%s_BANK_CONFLICT  \t\t : %10llu", header, d->stat_bank_conflict);
+  printf("\n%s_WRITE_DRAINS   \t\t : %10llu", header, d->stat_write_drain);
+  printf("\n");
+}
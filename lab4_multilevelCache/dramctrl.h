@@ -0,0 +1,93 @@
+#ifndef DRAMCTRL_H
+#define DRAMCTRL_H
+
+#include "types.h"
+
+typedef struct DRAM_Config DRAM_Config;
+typedef struct DRAM_Ctrl   DRAM_Ctrl;
+
+//////////////////////////////////////////////////////////////////
+// Banked DRAM timing model, used in place of the flat dram_access()
+// latency when DRAM_Config.model is DRAM_MODEL_BANKED.
+//
+// Line addresses map to row:rank:bank:column:channel, so consecutive
+// lines spread over channels and then fill a row. Every bank has a row
+// buffer; a request is a row hit (tCAS), a row miss on a precharged
+// bank (tRCD+tCAS), or a row conflict (tRP+tRCD+tCAS), and then holds
+// its channel's data bus for tBURST. With the closed-page policy a bank
+// precharges after every access, so all requests cost tRCD+tCAS.
+//
+// Callers need a read's latency when they issue it, so reads are
+// scheduled as they arrive. Writebacks are not latency critical: they
+// wait in a write queue, and the scheduler drains them FR-FCFS (row
+// hits first, then oldest), either into idle banks as row hits or,
+// when the queue is full, down to half its size.
+// All times are in CPU cycles.
+//////////////////////////////////////////////////////////////////
+
+typedef enum DRAM_Model_Enum {
+  DRAM_MODEL_FLAT,    // dram_access() from dram.c
+  DRAM_MODEL_BANKED,  // this model
+  NUM_DRAM_MODELS
+} DRAM_Model;
+
+typedef enum DRAM_Page_Policy_Enum {
+  DRAM_PAGE_OPEN,
+  DRAM_PAGE_CLOSED,
+  NUM_DRAM_PAGE_POLICIES
+} DRAM_Page_Policy;
+
+struct DRAM_Config {
+  uns64 model;          // DRAM_Model
+  uns64 channels;
+  uns64 ranks;          // per channel
+  uns64 banks;          // per rank
+  uns64 row_bytes;
+  uns64 page_policy;    // DRAM_Page_Policy
+  uns64 t_rcd;
+  uns64 t_cas;
+  uns64 t_rp;
+  uns64 t_burst;
+  uns64 write_queue;    // entries
+};
+
+typedef struct DRAM_Bank {
+  Flag  row_open;
+  uns64 open_row;
+  uns64 ready;          // cycle the bank can take its next command
+} DRAM_Bank;
+
+typedef struct DRAM_Write {
+  Addr  lineaddr;
+  uns64 arrival;
+} DRAM_Write;
+
+struct DRAM_Ctrl {
+  DRAM_Config cfg;
+  uns64       lines_per_row;
+
+  DRAM_Bank  *bank;     // [channel][rank][bank]
+  uns64      *bus_free; // [channel] cycle the data bus is free
+
+  DRAM_Write *wq;
+  uns64       wq_len;
+
+  //stats
+  uns64 stat_read_access;
+  uns64 stat_write_access;
+  uns64 stat_read_delay;
+  uns64 stat_row_hit;
+  uns64 stat_row_miss;       // bank precharged, no row to close
+  uns64 stat_row_conflict;   // another row was open
+  uns64 stat_bank_conflict;  // request waited for a busy bank
+  uns64 stat_write_drain;    // times a full write queue was drained
+};
+
+void       dramctrl_config_default(DRAM_Config *cfg);
+DRAM_Ctrl *dramctrl_new(DRAM_Config *cfg, uns64 linesize);
+void       dramctrl_delete(DRAM_Ctrl *d);
+uns64      dramctrl_access(DRAM_Ctrl *d, Addr lineaddr, Flag is_write, uns64 now);
+void       dramctrl_clear_stats(DRAM_Ctrl *d);
+void       dramctrl_print_stats(DRAM_Ctrl *d);
+
+#endif // DRAMCTRL_H
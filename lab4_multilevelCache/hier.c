@@ -0,0 +1,195 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hier.h"
+
+#define HIER_SERVES_IFETCH  1
+#define HIER_SERVES_DATA    2
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+static uns64 hier_number(char *filename, uns64 lineno, char *key, char *val){
+  char *end;
+  uns64 n = strtoull(val, &end, 10);
+  if(end != val && !strcmp(end, "KB")){
+    n *= 1024;
+  } else if(end != val && !strcmp(end, "MB")){
+    n *= 1024*1024;
+  } else if(end == val || *end){
+    printf("%s:%llu: bad value for %s: %s\n", filename, lineno, key, val);
+    exit(-1);
+  }
+  return n;
+}
+
+static int hier_find(Hierarchy *h, char *name){
+  for(uns64 i = 0; i < h->num_levels; i++){
+    if(!strcmp(h->level[i].name, name)){
+      return i;
+    }
+  }
+  return HIER_DRAM;
+}
+
+////////////////////////////////////////////////////////////////////
+// One level per line. The next= names are only resolved once the
+// whole file is read, and must point further down the file, so the
+// chain below every level ends at DRAM.
+////////////////////////////////////////////////////////////////////
+
+Hierarchy *hier_load(char *filename, uns64 linesize, uns64 repl_policy){
+  FILE *fp = fopen(filename, "r");
+  if(fp == NULL){
+    printf("Unable to open hierarchy file %s\n", filename);
+    exit(-1);
+  }
+
+  Hierarchy *h = (Hierarchy *) calloc (1, sizeof (Hierarchy));
+  char next_name[HIER_MAX_LEVELS][16];
+  uns64 serves[HIER_MAX_LEVELS];
+  uns64 lineno = 0;
+
+  char line[1024];
+  while(fgets(line, sizeof(line), fp)){
+    lineno++;
+    char *p = line + strspn(line, " \t");
+    if(*p == '\n' || *p == '\0' || *p == '#'){
+      continue;
+    }
+    if(h->num_levels == HIER_MAX_LEVELS){
+      printf("%s:%llu: more than %d levels\n", filename, lineno, HIER_MAX_LEVELS);
+      exit(-1);
+    }
+
+    uns64 i = h->num_levels++;
+    Hier_Level *l = &h->level[i];
+    uns64 size = 0, assoc = 0, repl = repl_policy, index_fn = INDEX_MODULO, way_pred = WAY_PRED_NONE;
+    strcpy(next_name[i], "dram");
+    serves[i] = 0;
+
+    for(char *tok = strtok(p, " \t\n"); tok; tok = strtok(NULL, " \t\n")){
+      char *val = strchr(tok, '=');
+      if(val == NULL){
+        printf("%s:%llu: expected key=value, got %s\n", filename, lineno, tok);
+        exit(-1);
+      }
+      *val++ = '\0';
+      if(!strcmp(tok, "name") || !strcmp(tok, "next")){
+        if(strlen(val) >= sizeof(l->name)){
+          printf("%s:%llu: level name %s is too long\n", filename, lineno, val);
+          exit(-1);
+        }
+        strcpy(!strcmp(tok, "name") ? l->name : next_name[i], val);
+      } else if(!strcmp(tok, "size")){
+        size = hier_number(filename, lineno, tok, val);
+      } else if(!strcmp(tok, "assoc")){
+        assoc = hier_number(filename, lineno, tok, val);
+      } else if(!strcmp(tok, "latency")){
+        l->latency = hier_number(filename, lineno, tok, val);
+      } else if(!strcmp(tok, "serves")){
+        if(!strcmp(val, "ifetch")){
+          serves[i] = HIER_SERVES_IFETCH;
+        } else if(!strcmp(val, "data")){
+          serves[i] = HIER_SERVES_DATA;
+        } else if(!strcmp(val, "both")){
+          serves[i] = HIER_SERVES_IFETCH | HIER_SERVES_DATA;
+        } else {
+          printf("%s:%llu: serves must be ifetch, data or both\n", filename, lineno);
+          exit(-1);
+        }
+      } else if(!strcmp(tok, "repl")){
+        repl = hier_number(filename, lineno, tok, val);
+      } else if(!strcmp(tok, "index")){
+        index_fn = hier_number(filename, lineno, tok, val);
+      } else if(!strcmp(tok, "waypred")){
+        way_pred = hier_number(filename, lineno, tok, val);
+      } else {
+        printf("%s:%llu: unknown key %s\n", filename, lineno, tok);
+        exit(-1);
+      }
+    }
+
+    if(l->name[0] == '\0' || !strcmp(l->name, "dram") || hier_find(h, l->name) != (int) i){
+      printf("%s:%llu: every level needs a unique name other than dram\n", filename, lineno);
+      exit(-1);
+    }
+    if(size == 0){
+      printf("%s:%llu: level %s needs a size\n", filename, lineno, l->name);
+      exit(-1);
+    }
+    l->cache = cache_new_indexed(size, assoc, linesize, repl, index_fn);
+    cache_set_way_pred(l->cache, way_pred);
+  }
+  fclose(fp);
+
+  h->ifetch_top = h->data_top = HIER_DRAM;
+  Flag reached[HIER_MAX_LEVELS] = {FALSE};
+  for(uns64 i = 0; i < h->num_levels; i++){
+    Hier_Level *l = &h->level[i];
+    if(strcmp(next_name[i], "dram")){
+      l->next = hier_find(h, next_name[i]);
+      if(l->next <= (int) i){
+        printf("Hierarchy level %s: next level %s must be defined after it\n", l->name, next_name[i]);
+        exit(-1);
+      }
+      reached[l->next] = TRUE;
+    } else {
+      l->next = HIER_DRAM;
+    }
+
+    if(serves[i] & HIER_SERVES_IFETCH){
+      if(h->ifetch_top != HIER_DRAM){
+        printf("Hierarchy: more than one level serves ifetch\n");
+        exit(-1);
+      }
+      h->ifetch_top = i;
+      reached[i] = TRUE;
+    }
+    if(serves[i] & HIER_SERVES_DATA){
+      if(h->data_top != HIER_DRAM){
+        printf("Hierarchy: more than one level serves data\n");
+        exit(-1);
+      }
+      h->data_top = i;
+      reached[i] = TRUE;
+    }
+  }
+
+  if(h->ifetch_top == HIER_DRAM || h->data_top == HIER_DRAM){
+    printf("Hierarchy %s: one level must serve ifetch and one data\n", filename);
+    exit(-1);
+  }
+  for(uns64 i = 0; i < h->num_levels; i++){
+    if(!reached[i]){
+      printf("Hierarchy level %s is never accessed\n", h->level[i].name);
+      exit(-1);
+    }
+  }
+
+  return h;
+}
+
+void hier_delete(Hierarchy *h){
+  for(uns64 i = 0; i < h->num_levels; i++){
+    cache_delete(h->level[i].cache);
+  }
+  free(h);
+}
+
+////////////////////////////////////////////////////////////////////
+// Every level under its own name, in file order
+////////////////////////////////////////////////////////////////////
+
+void hier_print_stats(Hierarchy *h){
+  for(uns64 i = 0; i < h->num_levels; i++){
+    cache_print_stats(h->level[i].cache, h->level[i].name);
+  }
+  for(uns64 i = 0; i < h->num_levels; i++){
+    if(h->level[i].cache->way_pred){
+      cache_print_way_pred_stats(h->level[i].cache, h->level[i].name);
+    }
+  }
+}
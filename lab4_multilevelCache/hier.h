@@ -0,0 +1,55 @@
+#ifndef HIER_H
+#define HIER_H
+
+#include "types.h"
+#include "cache.h"
+
+typedef struct Hierarchy Hierarchy;
+typedef struct Hier_Level Hier_Level;
+
+#define HIER_MAX_LEVELS 16
+#define HIER_DRAM       (-1)  // Hier_Level.next of a level backed by main memory
+
+//////////////////////////////////////////////////////////////////
+// A cache hierarchy described in a file (cfg.hierarchy_file) instead
+// of the built-in DCACHE/ICACHE + L2. Each non-comment line is one
+// level, as key=value pairs:
+//
+//   name=L2 size=1MB assoc=16 latency=10 next=L3
+//
+//   name     the stats header, up to 15 characters
+//   size     bytes, KB or MB
+//   assoc    ways, 0 (the default) for fully associative
+//   latency  hit latency in cycles
+//   next     the level its misses and writebacks go to, which must
+//            come later in the file; dram (the default) for memory
+//   serves   ifetch, data or both: the level that stream enters at.
+//            Each stream must enter at exactly one level.
+//   repl     Repl_Policy, default the memsys one
+//   index    Index_Fn, default modulo
+//   waypred  Way_Pred_Policy, default none
+//
+// A level that several others name as next is shared by them, so
+// split L1s over a unified L2, L3 and DRAM cache are all just lines
+// in the file. memsys_access_hier() walks the chain.
+//////////////////////////////////////////////////////////////////
+
+struct Hier_Level {
+  char   name[16];
+  Cache *cache;
+  uns64  latency;
+  int    next;     // index of the level below, or HIER_DRAM
+};
+
+struct Hierarchy {
+  uns64      num_levels;
+  Hier_Level level[HIER_MAX_LEVELS];
+  int        ifetch_top;  // level instruction fetches enter at
+  int        data_top;    // level loads and stores enter at
+};
+
+Hierarchy *hier_load(char *filename, uns64 linesize, uns64 repl_policy);
+void       hier_delete(Hierarchy *h);
+void       hier_print_stats(Hierarchy *h);
+
+#endif // HIER_H
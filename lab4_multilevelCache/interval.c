@@ -0,0 +1,89 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interval.h"
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+Interval_Log *interval_new(char *filename, uns64 every_accesses, uns64 every_cycles,
+                           uns64 num_counters, char **names){
+  if(every_accesses == 0 && every_cycles == 0){
+    printf("Interval statistics need an access or cycle period\n");
+    exit(-1);
+  }
+  assert(num_counters <= INTERVAL_MAX_COUNTERS);
+
+  Interval_Log *log = (Interval_Log *) calloc (1, sizeof (Interval_Log));
+  log->fp = fopen(filename, "w");
+  if(log->fp == NULL){
+    printf("Unable to open interval statistics file %s\n", filename);
+    exit(-1);
+  }
+  log->every_accesses = every_accesses;
+  log->every_cycles = every_cycles;
+  log->next_access = every_accesses ? every_accesses : ~0ULL;
+  log->next_cycle = every_cycles ? every_cycles : ~0ULL;
+  log->num_counters = num_counters;
+
+  fprintf(log->fp, "interval,end_access,end_cycle,accesses,cycles");
+  for(uns64 i = 0; i < num_counters; i++){
+    fprintf(log->fp, ",%s", names[i]);
+  }
+  fprintf(log->fp, "\n");
+  return log;
+}
+
+void interval_delete(Interval_Log *log){
+  fclose(log->fp);
+  free(log);
+}
+
+////////////////////////////////////////////////////////////////////
+// The owner calls this after every access, so it has to be cheap
+////////////////////////////////////////////////////////////////////
+
+Flag interval_due(Interval_Log *log, uns64 accesses, uns64 cycles){
+  return accesses >= log->next_access || cycles >= log->next_cycle;
+}
+
+void interval_write(Interval_Log *log, uns64 accesses, uns64 cycles, uns64 *counters){
+  fprintf(log->fp, "%llu,%llu,%llu,%llu,%llu", log->num_rows, accesses, cycles,
+          accesses - log->last_access, cycles - log->last_cycle);
+  for(uns64 i = 0; i < log->num_counters; i++){
+    fprintf(log->fp, ",%llu", counters[i] - log->last[i]);
+    log->last[i] = counters[i];
+  }
+  fprintf(log->fp, "\n");
+
+  log->num_rows++;
+  log->last_access = accesses;
+  log->last_cycle = cycles;
+
+  // one long access can cross several cycle periods: the next row
+  // is at the first period boundary after now
+  while(log->next_access <= accesses){
+    log->next_access += log->every_accesses;
+  }
+  while(log->next_cycle <= cycles){
+    log->next_cycle += log->every_cycles;
+  }
+}
+
+// The owner's counters and access count were reset to zero: go on
+// from there. The cycle axis keeps running.
+void interval_restart(Interval_Log *log){
+  memset(log->last, 0, sizeof(log->last));
+  log->last_access = 0;
+  log->next_access = log->every_accesses ? log->every_accesses : ~0ULL;
+}
+
+// The last, partial interval, if anything happened in it
+void interval_finish(Interval_Log *log, uns64 accesses, uns64 cycles, uns64 *counters){
+  if(accesses > log->last_access || cycles > log->last_cycle){
+    interval_write(log, accesses, cycles, counters);
+  }
+  fflush(log->fp);
+}
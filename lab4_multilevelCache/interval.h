@@ -0,0 +1,47 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+typedef struct Interval_Log Interval_Log;
+
+// Enough for every counter of a full hierarchy file (HIER_MAX_LEVELS
+// caches) with the TLBs and the banked DRAM
+#define INTERVAL_MAX_COUNTERS 384
+#define INTERVAL_NAME_LEN     48  // column name, with its terminating NUL
+
+//////////////////////////////////////////////////////////////////
+// Time series of a set of counters. Every every_accesses accesses
+// or every_cycles cycles (0 = not on that axis), interval_tick()
+// writes one CSV row holding how much each counter grew since the
+// row before, so phases show up that end-of-run totals average away.
+//
+// The owner passes the counters' current values in the same order
+// as the names given to interval_new(); interval_finish() writes
+// the last, partial interval.
+//////////////////////////////////////////////////////////////////
+
+struct Interval_Log {
+  FILE  *fp;
+  uns64  every_accesses;
+  uns64  every_cycles;
+  uns64  next_access;  // tick when accesses reach this ...
+  uns64  next_cycle;   // ... or cycles reach this
+  uns64  num_counters;
+  uns64  last[INTERVAL_MAX_COUNTERS]; // values at the previous row
+  uns64  last_access;
+  uns64  last_cycle;
+  uns64  num_rows;
+};
+
+Interval_Log *interval_new(char *filename, uns64 every_accesses, uns64 every_cycles,
+                           uns64 num_counters, char **names);
+void          interval_delete(Interval_Log *log);
+Flag          interval_due(Interval_Log *log, uns64 accesses, uns64 cycles);
+void          interval_write(Interval_Log *log, uns64 accesses, uns64 cycles, uns64 *counters);
+void          interval_finish(Interval_Log *log, uns64 accesses, uns64 cycles, uns64 *counters);
+void          interval_restart(Interval_Log *log);
+
+#endif // INTERVAL_H
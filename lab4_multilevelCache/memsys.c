@@ -5,6 +5,7 @@
 #include <math.h>
 
 #include "memsys.h"
+#include "repl.h"
 
 
 //---- Cache Latencies  ------
@@ -12,6 +13,13 @@
 #define DCACHE_HIT_LATENCY   1
 #define ICACHE_HIT_LATENCY   1
 #define L2CACHE_HIT_LATENCY  10
+#define VCACHE_HIT_LATENCY   1
+#define L2CACHE_BANK_BUSY    4   // cycles an L2 bank is occupied per access
+#define WAY_MISPREDICT_LATENCY 1 // L1 hit outside the predicted way
+#define DCACHE_BANK_BYTES    8   // DCACHE bank interleaving
+
+#define L2_SAMPLE_SCALE      256  // fixed point of the sampled-delay average
+#define L2_SAMPLE_DECAY      6    // it weighs the latest access 1/64
 
 extern MODE   SIM_MODE;
 extern uns64  CACHE_LINESIZE;
@@ -24,20 +32,553 @@ extern uns64  ICACHE_ASSOC;
 extern uns64  L2CACHE_SIZE;
 extern uns64  L2CACHE_ASSOC;
 
+//---- Stack-distance profiling, set by the driver (0 ways = off) ------
+
+uns64  STACKDIST_MAX_SETS = 65536;
+uns64  STACKDIST_MAX_WAYS = 0;
+
+//---- Three-C miss classification, set by the driver (0 = off) ------
+
+uns64  CLASSIFY_MISSES = 0;
+
+//---- Reuse-distance profiling, set by the driver (0 = off) ------
+
+uns64  REUSE_PROFILE = 0;
+
+//---- Interval statistics, set by the driver (0 = off on that axis) ------
+
+uns64  INTERVAL_ACCESSES = 0;
+uns64  INTERVAL_CYCLES   = 0;
+char  *INTERVAL_FILE     = "intervals.csv";
+
+//---- Prefetchers, set by the driver (policy 0 = off) ------
+
+uns64  DCACHE_PREFETCH           = PREFETCH_NONE;
+uns64  DCACHE_PREFETCH_DEGREE    = 1;
+uns64  DCACHE_PREFETCH_DISTANCE  = 1;
+uns64  ICACHE_PREFETCH           = PREFETCH_NONE;
+uns64  ICACHE_PREFETCH_DEGREE    = 1;
+uns64  ICACHE_PREFETCH_DISTANCE  = 1;
+uns64  L2CACHE_PREFETCH          = PREFETCH_NONE;
+uns64  L2CACHE_PREFETCH_DEGREE   = 1;
+uns64  L2CACHE_PREFETCH_DISTANCE = 1;
+
+//---- Non-blocking caches, set by the driver (0 DCACHE MSHRs = blocking) ------
+
+uns64  DCACHE_MSHRS  = 0;
+uns64  L2CACHE_MSHRS = 32;
+
+//---- Main memory, set by the driver (model 0 = flat dram.c latency) ------
+
+uns64  DRAM_MODEL       = DRAM_MODEL_FLAT;
+uns64  DRAM_CHANNELS    = 1;
+uns64  DRAM_BANKS       = 16;
+uns64  DRAM_PAGE_POLICY = DRAM_PAGE_OPEN;
+
+//---- DCACHE victim cache, set by the driver (0 entries = none) ------
+
+uns64  DCACHE_VICTIM_ENTRIES = 0;
+
+//---- DCACHE ports and banks, set by the driver (0 ports = unlimited) ------
+
+uns64  DCACHE_PORTS = 0;
+uns64  DCACHE_BANKS = 0;
+
+//---- L1 way prediction, set by the driver (0 = none, see cache.h) ------
+
+uns64  DCACHE_WAY_PRED = WAY_PRED_NONE;
+uns64  ICACHE_WAY_PRED = WAY_PRED_NONE;
+
+//---- Set-index functions, set by the driver (0 = modulo, see cache.h) ------
+
+uns64  DCACHE_INDEX  = INDEX_MODULO;
+uns64  ICACHE_INDEX  = INDEX_MODULO;
+uns64  L2CACHE_INDEX = INDEX_MODULO;
+
+//---- DCACHE write policy, set by the driver (0 = write-back, write-allocate) ------
+
+uns64  DCACHE_WRITE_THROUGH = 0;
+uns64  DCACHE_WRITE_MISS    = WRITE_ALLOCATE;
+uns64  DCACHE_WRITE_BUFFER  = 0;  // coalescing write buffer entries, 0 = none
+
+//---- Multicore (see multicore.h), set by the driver ------
+
+uns64  NUM_CORES     = 1;
+uns64  L2CACHE_BANKS = 0;  // 0 = one unbanked L2
+
+//---- L2 set sampling, set by the driver (0 = every set) ------
+
+uns64  L2CACHE_SAMPLING = 0;
+
+//---- Sectored caches, set by the driver (1 = whole-line tags and fills) ------
+
+uns64  CACHE_SECTORS = 1;
+
+//---- Warmup, set by the driver (0 = stats from the first access) ------
+
+uns64  WARMUP_ACCESSES = 0;
+
+//---- Cache hierarchy file, set by the driver (NULL = DCACHE/ICACHE/L2) ------
+
+char  *HIERARCHY_FILE = NULL;
+
+//---- Address translation, set by the driver (page size 0 = no TLBs) ------
+
+uns64  TLB_PAGE_SIZE = 0;
+uns64  DTLB_ENTRIES  = 64;
+uns64  STLB_ENTRIES  = 1536; // 0 = no L2 TLB
+
+//---- L1/L2 inclusion, set by the driver (0 = non-inclusive) ------
+
+uns64  L2CACHE_INCLUSION = INCLUSION_NINE;
+
+////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
+
+
+void memsys_config_default(Memsys_Config *cfg)
+{
+  memset(cfg, 0, sizeof(Memsys_Config));
+  cfg->sim_mode = SIM_MODE;
+  cfg->linesize = CACHE_LINESIZE;
+  cfg->repl_policy = REPL_POLICY;
+  cfg->dcache_size = DCACHE_SIZE;
+  cfg->dcache_assoc = DCACHE_ASSOC;
+  cfg->icache_size = ICACHE_SIZE;
+  cfg->icache_assoc = ICACHE_ASSOC;
+  cfg->l2cache_size = L2CACHE_SIZE;
+  cfg->l2cache_assoc = L2CACHE_ASSOC;
+  cfg->stackdist_max_sets = STACKDIST_MAX_SETS;
+  cfg->stackdist_max_ways = STACKDIST_MAX_WAYS;
+  cfg->classify_misses = CLASSIFY_MISSES;
+  cfg->reuse_profile = REUSE_PROFILE;
+  cfg->interval_accesses = INTERVAL_ACCESSES;
+  cfg->interval_cycles = INTERVAL_CYCLES;
+  cfg->interval_file = INTERVAL_FILE;
+  cfg->dcache_pf.policy = DCACHE_PREFETCH;
+  cfg->dcache_pf.degree = DCACHE_PREFETCH_DEGREE;
+  cfg->dcache_pf.distance = DCACHE_PREFETCH_DISTANCE;
+  cfg->icache_pf.policy = ICACHE_PREFETCH;
+  cfg->icache_pf.degree = ICACHE_PREFETCH_DEGREE;
+  cfg->icache_pf.distance = ICACHE_PREFETCH_DISTANCE;
+  cfg->l2cache_pf.policy = L2CACHE_PREFETCH;
+  cfg->l2cache_pf.degree = L2CACHE_PREFETCH_DEGREE;
+  cfg->l2cache_pf.distance = L2CACHE_PREFETCH_DISTANCE;
+  cfg->dcache_mshrs = DCACHE_MSHRS;
+  cfg->l2cache_mshrs = L2CACHE_MSHRS;
+  cfg->l2cache_inclusion = L2CACHE_INCLUSION;
+  cfg->dcache_victims = DCACHE_VICTIM_ENTRIES;
+  cfg->dcache_ports = DCACHE_PORTS;
+  cfg->dcache_banks = DCACHE_BANKS;
+  cfg->dcache_way_pred = DCACHE_WAY_PRED;
+  cfg->icache_way_pred = ICACHE_WAY_PRED;
+  cfg->dcache_index = DCACHE_INDEX;
+  cfg->icache_index = ICACHE_INDEX;
+  cfg->l2cache_index = L2CACHE_INDEX;
+  cfg->dcache_write_through = DCACHE_WRITE_THROUGH;
+  cfg->dcache_write_miss = DCACHE_WRITE_MISS;
+  cfg->dcache_write_buffer = DCACHE_WRITE_BUFFER;
+  cfg->num_cores = NUM_CORES;
+  cfg->l2cache_banks = L2CACHE_BANKS;
+  cfg->l2cache_sampling = L2CACHE_SAMPLING;
+  cfg->sectors = CACHE_SECTORS;
+  cfg->warmup_accesses = WARMUP_ACCESSES;
+  cfg->hierarchy_file = HIERARCHY_FILE;
+  dramctrl_config_default(&cfg->dram);
+  cfg->dram.model = DRAM_MODEL;
+  cfg->dram.channels = DRAM_CHANNELS;
+  cfg->dram.banks = DRAM_BANKS;
+  cfg->dram.page_policy = DRAM_PAGE_POLICY;
+  tlb_config_default(&cfg->tlb);
+  cfg->tlb.page_size = TLB_PAGE_SIZE;
+  cfg->tlb.dtlb_entries = DTLB_ENTRIES;
+  cfg->tlb.stlb_entries = STLB_ENTRIES;
+}
+
+
 ////////////////////////////////////////////////////////////////////
+// Counters in the interval statistics: every counter of the caches
+// and units this configuration built, current values into counters
+// and (if names is not NULL) their column names into the
+// INTERVAL_NAME_LEN-byte buffers names points to. Returns how many.
+////////////////////////////////////////////////////////////////////
+
+static void memsys_interval_add(uns64 *counters, char **names, uns64 *n,
+                                char *prefix, char *name, uns64 value)
+{
+  assert(*n < INTERVAL_MAX_COUNTERS);
+  if(names){
+    snprintf(names[*n], INTERVAL_NAME_LEN, "%s%s", prefix, name);
+  }
+  counters[(*n)++] = value;
+}
+
+static void memsys_interval_cache(Cache *c, char *prefix, uns64 *counters, char **names, uns64 *n)
+{
+  memsys_interval_add(counters, names, n, prefix, "read_access", c->stat_read_access);
+  memsys_interval_add(counters, names, n, prefix, "write_access", c->stat_write_access);
+  memsys_interval_add(counters, names, n, prefix, "read_miss", c->stat_read_miss);
+  memsys_interval_add(counters, names, n, prefix, "write_miss", c->stat_write_miss);
+  memsys_interval_add(counters, names, n, prefix, "dirty_evicts", c->stat_dirty_evicts);
+  if(c->way_pred){
+    memsys_interval_add(counters, names, n, prefix, "way_pred_hit", c->stat_way_pred_hit);
+    memsys_interval_add(counters, names, n, prefix, "way_pred_miss", c->stat_way_pred_miss);
+  }
+  if(c->num_sectors > 1){
+    memsys_interval_add(counters, names, n, prefix, "sector_miss", c->stat_sector_miss);
+    memsys_interval_add(counters, names, n, prefix, "dirty_sector_evicts", c->stat_dirty_sector_evicts);
+  }
+  if(c->set_sampled){
+    memsys_interval_add(counters, names, n, prefix, "skipped_read", c->stat_skipped_read);
+    memsys_interval_add(counters, names, n, prefix, "skipped_write", c->stat_skipped_write);
+  }
+  if(c->threec){
+    memsys_interval_add(counters, names, n, prefix, "compulsory_miss", c->stat_threec_miss[THREEC_COMPULSORY]);
+    memsys_interval_add(counters, names, n, prefix, "capacity_miss", c->stat_threec_miss[THREEC_CAPACITY]);
+    memsys_interval_add(counters, names, n, prefix, "conflict_miss", c->stat_threec_miss[THREEC_CONFLICT]);
+    if(c->num_sectors > 1){
+      memsys_interval_add(counters, names, n, prefix, "sector_3c_miss", c->stat_threec_miss[THREEC_SECTOR]);
+    }
+  }
+}
+
+static void memsys_interval_prefetcher(Prefetcher *pf, char *prefix, uns64 *counters, char **names, uns64 *n)
+{
+  memsys_interval_add(counters, names, n, prefix, "issued", pf->stat_issued);
+  memsys_interval_add(counters, names, n, prefix, "useful", pf->stat_useful);
+  memsys_interval_add(counters, names, n, prefix, "late", pf->stat_late);
+  memsys_interval_add(counters, names, n, prefix, "polluting", pf->stat_polluting);
+}
+
+static void memsys_interval_mshr(MSHR_File *m, char *prefix, uns64 *counters, char **names, uns64 *n)
+{
+  memsys_interval_add(counters, names, n, prefix, "primary_miss", m->stat_primary);
+  memsys_interval_add(counters, names, n, prefix, "merged_miss", m->stat_secondary);
+  memsys_interval_add(counters, names, n, prefix, "full", m->stat_full);
+  memsys_interval_add(counters, names, n, prefix, "full_cycles", m->stat_full_cycles);
+  memsys_interval_add(counters, names, n, prefix, "busy_sum", m->stat_busy_sum);
+  memsys_interval_add(counters, names, n, prefix, "busy_cycles", m->stat_busy_cycles);
+}
+
+static uns64 memsys_interval_counters(Memsys *sys, uns64 *counters, char **names)
+{
+  uns64 n = 0;
+
+  memsys_interval_add(counters, names, &n, "", "ifetch_access", sys->stat_ifetch_access);
+  memsys_interval_add(counters, names, &n, "", "load_access", sys->stat_load_access);
+  memsys_interval_add(counters, names, &n, "", "store_access", sys->stat_store_access);
+  memsys_interval_add(counters, names, &n, "", "ifetch_delay", sys->stat_ifetch_delay);
+  memsys_interval_add(counters, names, &n, "", "load_delay", sys->stat_load_delay);
+  memsys_interval_add(counters, names, &n, "", "store_delay", sys->stat_store_delay);
+
+  if(sys->cfg.sim_mode!=SIM_MODE_A && sys->cfg.l2cache_inclusion!=INCLUSION_NINE){
+    memsys_interval_add(counters, names, &n, "", "back_invals", sys->stat_back_invals);
+    memsys_interval_add(counters, names, &n, "", "back_inval_dirty", sys->stat_back_inval_dirty);
+    memsys_interval_add(counters, names, &n, "", "victim_fills", sys->stat_victim_fills);
+  }
+  if(sys->cfg.sim_mode!=SIM_MODE_A && sys->cfg.dcache_ports){
+    memsys_interval_add(counters, names, &n, "", "dcache_port_conflicts", sys->stat_dcache_port_conflicts);
+    memsys_interval_add(counters, names, &n, "", "dcache_bank_conflicts", sys->stat_dcache_bank_conflicts);
+    memsys_interval_add(counters, names, &n, "", "dcache_port_wait", sys->stat_dcache_port_wait);
+  }
+  if(sys->cfg.num_cores > 1 && sys->cfg.l2cache_banks){
+    memsys_interval_add(counters, names, &n, "", "l2_bank_wait", sys->stat_l2_bank_wait);
+  }
+
+  // a hierarchy logs each of its levels, which dcache, icache and
+  // l2cache only alias
+  if(sys->hier){
+    for(uns64 i = 0; i < sys->hier->num_levels; i++){
+      char prefix[INTERVAL_NAME_LEN];
+      snprintf(prefix, sizeof(prefix), "%s_", sys->hier->level[i].name);
+      memsys_interval_cache(sys->hier->level[i].cache, prefix, counters, names, &n);
+    }
+  } else {
+    memsys_interval_cache(sys->dcache, "dcache_", counters, names, &n);
+    if(sys->cfg.sim_mode!=SIM_MODE_A){
+      memsys_interval_cache(sys->icache, "icache_", counters, names, &n);
+      memsys_interval_cache(sys->l2cache, "l2cache_", counters, names, &n);
+    }
+  }
+  if(sys->vcache){
+    memsys_interval_cache(sys->vcache, "vcache_", counters, names, &n);
+  }
+
+  if(sys->dcache_pf){
+    memsys_interval_prefetcher(sys->dcache_pf, "dcache_pf_", counters, names, &n);
+  }
+  if(sys->icache_pf){
+    memsys_interval_prefetcher(sys->icache_pf, "icache_pf_", counters, names, &n);
+  }
+  if(sys->l2cache_pf){
+    memsys_interval_prefetcher(sys->l2cache_pf, "l2cache_pf_", counters, names, &n);
+  }
+
+  if(sys->events){
+    memsys_interval_mshr(sys->dcache_mshr, "dcache_mshr_", counters, names, &n);
+    memsys_interval_mshr(sys->l2cache_mshr, "l2cache_mshr_", counters, names, &n);
+  }
+
+  if(sys->dcache_wbuf){
+    Write_Buffer *wb = sys->dcache_wbuf;
+    memsys_interval_add(counters, names, &n, "dcache_wbuf_", "writes", wb->stat_writes);
+    memsys_interval_add(counters, names, &n, "dcache_wbuf_", "coalesced", wb->stat_coalesced);
+    memsys_interval_add(counters, names, &n, "dcache_wbuf_", "full", wb->stat_full);
+    memsys_interval_add(counters, names, &n, "dcache_wbuf_", "full_cycles", wb->stat_full_cycles);
+    memsys_interval_add(counters, names, &n, "dcache_wbuf_", "raw_cycles", wb->stat_raw_cycles);
+  }
+
+  if(sys->tlb){
+    memsys_interval_cache(sys->tlb->itlb, "itlb_", counters, names, &n);
+    memsys_interval_cache(sys->tlb->dtlb, "dtlb_", counters, names, &n);
+    if(sys->tlb->stlb){
+      memsys_interval_cache(sys->tlb->stlb, "stlb_", counters, names, &n);
+    }
+    memsys_interval_add(counters, names, &n, "tlb_", "walks", sys->tlb->stat_walks);
+    memsys_interval_add(counters, names, &n, "tlb_", "walk_accesses", sys->tlb->stat_walk_accesses);
+    memsys_interval_add(counters, names, &n, "tlb_", "walk_delay", sys->tlb->stat_walk_delay);
+    memsys_interval_add(counters, names, &n, "tlb_", "delay", sys->tlb->stat_delay);
+  }
+
+  if(sys->dramctrl){
+    DRAM_Ctrl *d = sys->dramctrl;
+    memsys_interval_add(counters, names, &n, "dram_", "read_access", d->stat_read_access);
+    memsys_interval_add(counters, names, &n, "dram_", "write_access", d->stat_write_access);
+    memsys_interval_add(counters, names, &n, "dram_", "read_delay", d->stat_read_delay);
+    memsys_interval_add(counters, names, &n, "dram_", "row_hit", d->stat_row_hit);
+    memsys_interval_add(counters, names, &n, "dram_", "row_miss", d->stat_row_miss);
+    memsys_interval_add(counters, names, &n, "dram_", "row_conflict", d->stat_row_conflict);
+    memsys_interval_add(counters, names, &n, "dram_", "bank_conflict", d->stat_bank_conflict);
+    memsys_interval_add(counters, names, &n, "dram_", "write_drain", d->stat_write_drain);
+  } else if(sys->cfg.sim_mode!=SIM_MODE_A){
+    memsys_interval_add(counters, names, &n, "dram_", "read_access", sys->dram->stat_read_access);
+    memsys_interval_add(counters, names, &n, "dram_", "write_access", sys->dram->stat_write_access);
+  }
+  return n;
+}
+
+// After every access; finish writes the last, partial interval
+static void memsys_interval_tick(Memsys *sys, Flag finish)
+{
+  uns64 accesses = sys->stat_ifetch_access + sys->stat_load_access + sys->stat_store_access;
+  uns64 cycles = memsys_cycles(sys);
+  uns64 counters[INTERVAL_MAX_COUNTERS];
+
+  if(finish){
+    memsys_interval_counters(sys, counters, NULL);
+    interval_finish(sys->interval, accesses, cycles, counters);
+  } else if(interval_due(sys->interval, accesses, cycles)){
+    memsys_interval_counters(sys, counters, NULL);
+    interval_write(sys->interval, accesses, cycles, counters);
+  }
+}
 
 
 Memsys *memsys_new(void)
+{
+  Memsys_Config cfg;
+  memsys_config_default(&cfg);
+  return memsys_new_config(&cfg);
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Levels from cfg->hierarchy_file. Only the blocking walk down the
+// chain (memsys_access_hier) knows about them, so the features that
+// are built around a fixed DCACHE/ICACHE/L2 are turned away.
+////////////////////////////////////////////////////////////////////
+
+static void memsys_new_hier(Memsys *sys, Memsys_Config *cfg)
+{
+  if(cfg->sim_mode == SIM_MODE_A || cfg->dcache_mshrs || cfg->l2cache_inclusion != INCLUSION_NINE
+     || cfg->dcache_victims || cfg->dcache_write_through || cfg->dcache_write_miss != WRITE_ALLOCATE
+     || cfg->dcache_write_buffer || cfg->l2cache_sampling > 1 || cfg->sectors > 1
+     || cfg->dcache_pf.policy != PREFETCH_NONE || cfg->icache_pf.policy != PREFETCH_NONE
+     || cfg->l2cache_pf.policy != PREFETCH_NONE){
+    printf("A hierarchy file needs mode B/C with blocking, write-back, write-allocate, non-inclusive caches,"
+           " and no prefetchers, victim cache, write buffer, set sampling or sectors\n");
+    exit(-1);
+  }
+
+  Hierarchy *h = hier_load(cfg->hierarchy_file, cfg->linesize, cfg->repl_policy);
+  if(h->level[h->data_top].next == HIER_DRAM){
+    printf("Hierarchy %s: the data level needs a level below it\n", cfg->hierarchy_file);
+    exit(-1);
+  }
+  sys->hier = h;
+  sys->dcache = h->level[h->data_top].cache;
+  sys->icache = h->level[h->ifetch_top].cache;
+  sys->l2cache = h->level[h->level[h->data_top].next].cache;
+
+  if(cfg->classify_misses){
+    for(uns64 i = 0; i < h->num_levels; i++){
+      cache_enable_threec(h->level[i].cache);
+    }
+  }
+}
+
+
+Memsys *memsys_new_config(Memsys_Config *cfg)
 {
   Memsys *sys = (Memsys *) calloc (1, sizeof (Memsys));
+  sys->cfg = *cfg;
+  sys->warmup_left = cfg->warmup_accesses;
+
+  if(cfg->hierarchy_file){
+    memsys_new_hier(sys, cfg);
+  } else {
+    sys->dcache = cache_new_indexed(cfg->dcache_size, cfg->dcache_assoc, cfg->linesize, cfg->repl_policy,
+                                    cfg->dcache_index);
+  }
+
+  if(cfg->sectors > 1 && (cfg->sim_mode == SIM_MODE_A || cfg->dcache_mshrs
+                          || cfg->l2cache_inclusion != INCLUSION_NINE || cfg->dcache_victims
+                          || cfg->dcache_write_buffer || cfg->dcache_pf.policy != PREFETCH_NONE
+                          || cfg->icache_pf.policy != PREFETCH_NONE || cfg->l2cache_pf.policy != PREFETCH_NONE
+                          || cfg->sectors > cfg->linesize)){
+    printf("Sectored caches need mode B/C with blocking, non-inclusive caches, no prefetchers,"
+           " victim cache or write buffer, and sectors no smaller than a byte\n");
+    exit(-1);
+  }
 
-  sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+  if(cfg->sim_mode!=SIM_MODE_A){
+    if(sys->hier == NULL){
+      sys->icache = cache_new_indexed(cfg->icache_size, cfg->icache_assoc, cfg->linesize, cfg->repl_policy,
+                                      cfg->icache_index);
+      sys->l2cache = cache_new_indexed(cfg->l2cache_size, cfg->l2cache_assoc, cfg->linesize, cfg->repl_policy,
+                                       cfg->l2cache_index);
 
-  if(SIM_MODE!=SIM_MODE_A){
-    sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
-    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+      cache_set_way_pred(sys->dcache, cfg->dcache_way_pred);
+      cache_set_way_pred(sys->icache, cfg->icache_way_pred);
+    }
     sys->dram    = dram_new();
+
+    if(cfg->sectors > 1){
+      cache_set_sectors(sys->dcache, cfg->sectors);
+      cache_set_sectors(sys->icache, cfg->sectors);
+      cache_set_sectors(sys->l2cache, cfg->sectors);
+    }
+
+    if(cfg->l2cache_sampling > 1){
+      if(cfg->dcache_mshrs || cfg->l2cache_inclusion != INCLUSION_NINE
+         || cfg->l2cache_pf.policy != PREFETCH_NONE || cfg->classify_misses){
+        printf("L2 set sampling needs blocking, non-inclusive caches, no L2 prefetcher"
+               " and no miss classification\n");
+        exit(-1);
+      }
+      cache_enable_sampling(sys->l2cache, cfg->l2cache_sampling);
+    }
+
+    if(cfg->dcache_write_miss >= NUM_WRITE_MISS_POLICIES){
+      printf("Unknown DCACHE write miss policy %llu\n", cfg->dcache_write_miss);
+      exit(-1);
+    }
+    if(cfg->dcache_write_buffer){
+      sys->dcache_wbuf = writebuf_new(cfg->dcache_write_buffer, L2CACHE_HIT_LATENCY);
+    }
+
+    if(cfg->dcache_victims){
+      // fully associative: one set of dcache_victims ways
+      sys->vcache = cache_new(cfg->dcache_victims*cfg->linesize, 0, cfg->linesize, REPL_LRU);
+    }
+
+    if(cfg->l2cache_inclusion >= NUM_INCLUSION_POLICIES){
+      printf("Unknown L2 inclusion policy %llu\n", cfg->l2cache_inclusion);
+      exit(-1);
+    }
+    if(cfg->l2cache_inclusion == INCLUSION_EXCLUSIVE
+       && (cfg->dcache_write_through || cfg->dcache_write_miss == WRITE_VALIDATE)){
+      // both would put a line in the L2 and the DCACHE at once
+      printf("An exclusive L2 needs a write-back DCACHE that reads the line on a write miss\n");
+      exit(-1);
+    }
+    if(cfg->dram.model == DRAM_MODEL_BANKED){
+      sys->dramctrl = dramctrl_new(&cfg->dram, cfg->linesize);
+    }
+    if(cfg->dcache_banks > 1){
+      if(cfg->dcache_ports == 0){
+        printf("DCACHE banks need a number of DCACHE ports\n");
+        exit(-1);
+      }
+      sys->dcache_bank_cycle = (uns64 *) malloc (cfg->dcache_banks * sizeof(uns64));
+      sys->dcache_bank_line = (Addr *) malloc (cfg->dcache_banks * sizeof(Addr));
+      memset(sys->dcache_bank_cycle, 0xff, cfg->dcache_banks * sizeof(uns64)); // never accessed
+    }
+    if(cfg->tlb.page_size){
+      if(cfg->dcache_mshrs){
+        printf("Address translation is not supported with non-blocking caches\n");
+        exit(-1);
+      }
+      sys->tlb = tlb_new(&cfg->tlb);
+    }
+
+    if(cfg->dcache_pf.policy != PREFETCH_NONE){
+      sys->dcache_pf = prefetcher_new(&cfg->dcache_pf);
+    }
+    if(cfg->icache_pf.policy != PREFETCH_NONE){
+      sys->icache_pf = prefetcher_new(&cfg->icache_pf);
+    }
+    if(cfg->l2cache_pf.policy != PREFETCH_NONE){
+      sys->l2cache_pf = prefetcher_new(&cfg->l2cache_pf);
+    }
+
+    if(cfg->dcache_mshrs){
+      if(sys->dcache_pf || sys->icache_pf || sys->l2cache_pf){
+        printf("Prefetchers are not supported with non-blocking caches\n");
+        exit(-1);
+      }
+      if(cfg->dcache_write_through || cfg->dcache_write_miss != WRITE_ALLOCATE || cfg->dcache_write_buffer){
+        printf("Non-blocking caches only support write-back, write-allocate DCACHEs\n");
+        exit(-1);
+      }
+      if(cfg->l2cache_inclusion == INCLUSION_EXCLUSIVE){
+        printf("An exclusive L2 is not supported with non-blocking caches\n");
+        exit(-1);
+      }
+      if(cfg->l2cache_mshrs == 0){
+        printf("Non-blocking mode needs at least one L2 MSHR\n");
+        exit(-1);
+      }
+      sys->dcache_mshr = mshr_new(cfg->dcache_mshrs);
+      sys->l2cache_mshr = mshr_new(cfg->l2cache_mshrs);
+      sys->events = event_queue_new();
+    }
+  }
+
+  if(cfg->classify_misses){
+    cache_enable_threec(sys->dcache);
+    if(cfg->sim_mode!=SIM_MODE_A){
+      cache_enable_threec(sys->icache);
+      cache_enable_threec(sys->l2cache);
+    }
+  }
+
+  if(cfg->reuse_profile){
+    sys->rd_dcache = reuse_new();
+    if(cfg->sim_mode!=SIM_MODE_A){
+      sys->rd_icache = reuse_new();
+      sys->rd_l2cache = reuse_new();
+    }
+  }
+
+  if(cfg->interval_accesses || cfg->interval_cycles){
+    char name_buf[INTERVAL_MAX_COUNTERS][INTERVAL_NAME_LEN];
+    char *names[INTERVAL_MAX_COUNTERS];
+    uns64 counters[INTERVAL_MAX_COUNTERS];
+    for(uns64 i = 0; i < INTERVAL_MAX_COUNTERS; i++){
+      names[i] = name_buf[i];
+    }
+    uns64 n = memsys_interval_counters(sys, counters, names);
+    sys->interval = interval_new(cfg->interval_file, cfg->interval_accesses,
+                                 cfg->interval_cycles, n, names);
+  }
+
+  if(cfg->stackdist_max_ways){
+    sys->sd_dcache = stackdist_new(cfg->stackdist_max_sets, cfg->stackdist_max_ways);
+    if(cfg->sim_mode!=SIM_MODE_A){
+      sys->sd_icache = stackdist_new(cfg->stackdist_max_sets, cfg->stackdist_max_ways);
+      sys->sd_l2cache = stackdist_new(cfg->stackdist_max_sets, cfg->stackdist_max_ways);
+    }
   }
 
   return sys;
@@ -45,24 +586,243 @@ Memsys *memsys_new(void)
 }
 
 
+void memsys_delete(Memsys *sys)
+{
+  if(sys->interval){
+    memsys_interval_tick(sys, TRUE);
+    interval_delete(sys->interval);
+  }
+
+  if(sys->hier){
+    hier_delete(sys->hier);
+    free(sys->dram);
+  } else {
+    cache_delete(sys->dcache);
+
+    if(sys->cfg.sim_mode!=SIM_MODE_A){
+      cache_delete(sys->icache);
+      cache_delete(sys->l2cache);
+      free(sys->dram);
+    }
+  }
+
+  if(sys->vcache){
+    cache_delete(sys->vcache);
+  }
+  if(sys->dcache_wbuf){
+    writebuf_delete(sys->dcache_wbuf);
+  }
+
+  if(sys->dramctrl){
+    dramctrl_delete(sys->dramctrl);
+  }
+  if(sys->tlb){
+    tlb_delete(sys->tlb);
+  }
+  free(sys->dcache_bank_cycle);
+  free(sys->dcache_bank_line);
+
+  if(sys->dcache_pf){
+    prefetcher_delete(sys->dcache_pf);
+  }
+  if(sys->icache_pf){
+    prefetcher_delete(sys->icache_pf);
+  }
+  if(sys->l2cache_pf){
+    prefetcher_delete(sys->l2cache_pf);
+  }
+  if(sys->events){
+    mshr_delete(sys->dcache_mshr);
+    mshr_delete(sys->l2cache_mshr);
+    event_queue_delete(sys->events);
+  }
+
+  if(sys->sd_dcache){
+    stackdist_delete(sys->sd_dcache);
+  }
+  if(sys->sd_icache){
+    stackdist_delete(sys->sd_icache);
+    stackdist_delete(sys->sd_l2cache);
+  }
+
+  if(sys->rd_dcache){
+    reuse_delete(sys->rd_dcache);
+  }
+  if(sys->rd_icache){
+    reuse_delete(sys->rd_icache);
+    reuse_delete(sys->rd_l2cache);
+  }
+
+  free(sys);
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Measured regions: while functional is set, accesses only warm the
+// caches (see memsys_access_functional) and take no time. Clearing
+// the stats starts a new measured region; the stack-distance and
+// reuse profiles, which functional accesses do not feed, are kept.
+////////////////////////////////////////////////////////////////////
+
+void memsys_set_functional(Memsys *sys, Flag functional)
+{
+  sys->functional = functional;
+}
+
+void memsys_clear_stats(Memsys *sys)
+{
+  if(sys->interval){
+    memsys_interval_tick(sys, TRUE);
+  }
+
+  sys->stat_ifetch_access = 0;
+  sys->stat_load_access = 0;
+  sys->stat_store_access = 0;
+  sys->stat_ifetch_delay = 0;
+  sys->stat_load_delay = 0;
+  sys->stat_store_delay = 0;
+  sys->stat_back_invals = 0;
+  sys->stat_back_inval_dirty = 0;
+  sys->stat_victim_fills = 0;
+  sys->stat_l2_bank_wait = 0;
+  sys->stat_dcache_port_conflicts = 0;
+  sys->stat_dcache_bank_conflicts = 0;
+  sys->stat_dcache_port_wait = 0;
+
+  if(sys->hier){
+    for(uns64 i = 0; i < sys->hier->num_levels; i++){
+      cache_clear_stats(sys->hier->level[i].cache);
+    }
+  } else {
+    cache_clear_stats(sys->dcache);
+  }
+  if(sys->cfg.sim_mode!=SIM_MODE_A){
+    if(sys->hier == NULL){
+      cache_clear_stats(sys->icache);
+      cache_clear_stats(sys->l2cache);
+    }
+    sys->dram->stat_read_access = 0;
+    sys->dram->stat_write_access = 0;
+    sys->dram->stat_read_delay = 0;
+    sys->dram->stat_write_delay = 0;
+  }
+  if(sys->vcache){
+    cache_clear_stats(sys->vcache);
+  }
+  if(sys->dcache_wbuf){
+    writebuf_clear_stats(sys->dcache_wbuf);
+  }
+  if(sys->dramctrl){
+    dramctrl_clear_stats(sys->dramctrl);
+  }
+  if(sys->tlb){
+    tlb_clear_stats(sys->tlb);
+  }
+  if(sys->dcache_pf){
+    prefetcher_clear_stats(sys->dcache_pf);
+  }
+  if(sys->icache_pf){
+    prefetcher_clear_stats(sys->icache_pf);
+  }
+  if(sys->l2cache_pf){
+    prefetcher_clear_stats(sys->l2cache_pf);
+  }
+  if(sys->events){
+    mshr_clear_stats(sys->dcache_mshr);
+    mshr_clear_stats(sys->l2cache_mshr);
+  }
+
+  if(sys->interval){
+    interval_restart(sys->interval);
+  }
+}
+
+// A separate warmup trace: every record through the functional path,
+// then the stats are cleared
+void memsys_warm_trace(Memsys *sys, Trace *trace)
+{
+  Flag functional = sys->functional;
+  memsys_set_functional(sys, TRUE);
+  for(uns64 i = 0; i < trace->num_recs; i++){
+    Addr addr = trace_rec_addr(trace->recs[i]);
+    Access_Type type = trace_rec_type(trace->recs[i]);
+    memsys_access_pc(sys, addr, type, trace->pcs ? trace->pcs[i] : (type==ACCESS_TYPE_IFETCH) ? addr : 0);
+  }
+  memsys_set_functional(sys, functional);
+  memsys_clear_stats(sys);
+}
+
+
 ////////////////////////////////////////////////////////////////////
 // This function takes an ifetch/ldst access and returns the delay
+// pc is the address of the instruction making the access (0 if the
+// trace does not have it); the stride prefetcher and the PC way
+// predictor use it
 ////////////////////////////////////////////////////////////////////
 
 uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type)
+{
+  return memsys_access_pc(sys, addr, type, (type==ACCESS_TYPE_IFETCH) ? addr : 0);
+}
+
+
+uns64 memsys_access_pc(Memsys *sys, Addr addr, Access_Type type, Addr pc)
 {
   uns delay=0;
 
+  sys->access_pc = pc;
+  sys->access_type = type;
+  sys->access_addr = addr;
+
 
   // all cache transactions happen at line granularity, so get lineaddr
-  Addr lineaddr=addr/CACHE_LINESIZE;
+  Addr lineaddr=addr/sys->cfg.linesize;
+  if(sys->cfg.sectors > 1){
+    sys->access_sector = (addr % sys->cfg.linesize) / (sys->cfg.linesize / sys->cfg.sectors);
+  }
 
+  if(sys->functional || sys->warmup_left){
+    if(sys->tlb){
+      memsys_translate_functional(sys, addr, type);
+    }
+    memsys_access_functional(sys, lineaddr, type);
+    if(sys->warmup_left && --sys->warmup_left == 0){
+      memsys_clear_stats(sys);
+    }
+    return 0;
+  }
+
+  if(sys->sd_dcache && type!=ACCESS_TYPE_IFETCH){
+    stackdist_access(sys->sd_dcache, lineaddr, type);
+  }
+  if(sys->sd_icache && type==ACCESS_TYPE_IFETCH){
+    stackdist_access(sys->sd_icache, lineaddr, type);
+  }
+  if(sys->rd_dcache && type!=ACCESS_TYPE_IFETCH){
+    reuse_access(sys->rd_dcache, lineaddr, type);
+  }
+  if(sys->rd_icache && type==ACCESS_TYPE_IFETCH){
+    reuse_access(sys->rd_icache, lineaddr, type);
+  }
 
-  if(SIM_MODE==SIM_MODE_A){
+  // the translation delay is already on the clock
+  uns64 tlb_delay = 0;
+  if(sys->tlb){
+    tlb_delay = memsys_translate(sys, addr, type);
+  }
+
+  if(sys->cfg.sim_mode==SIM_MODE_A){
     delay = memsys_access_modeA(sys,lineaddr,type);
+  }else if(sys->events){
+    delay = memsys_access_nonblocking(sys,lineaddr,type);
+  }else if(sys->hier){
+    delay = memsys_access_hier(sys,lineaddr,type);
+    sys->clock += delay;
   }else{
     delay = memsys_access_modeBC(sys,lineaddr,type);
+    sys->clock += delay;
   }
+  delay += tlb_delay;
 
 
   //update the stats
@@ -81,6 +841,9 @@ uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type)
     sys->stat_store_delay+=delay;
   }
 
+  if(sys->interval){
+    memsys_interval_tick(sys, FALSE);
+  }
 
   return delay;
 }
@@ -90,11 +853,8 @@ uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type)
 ////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
 
-void memsys_print_stats(Memsys *sys)
+void memsys_print_access_stats(Memsys *sys, char *header)
 {
-  char header[256];
-  sprintf(header, "MEMSYS");
-
   double ifetch_delay_avg=0;
   double load_delay_avg=0;
   double store_delay_avg=0;
@@ -119,14 +879,121 @@ void memsys_print_stats(Memsys *sys)
   printf("\n%s_IFETCH_AVGDELAY\t\t : %10.3f",  header, ifetch_delay_avg);
   printf("\n%s_LOAD_AVGDELAY  \t\t : %10.3f",  header, load_delay_avg);
   printf("\n%s_STORE_AVGDELAY \t\t : %10.3f",  header, store_delay_avg);
+  if(sys->cfg.sim_mode!=SIM_MODE_A && sys->cfg.l2cache_inclusion!=INCLUSION_NINE){
+    printf("\n%s_BACK_INVALS   \t\t : %10llu",  header, sys->stat_back_invals);
+    printf("\n%s_BACK_INVAL_DIRTY\t\t : %10llu",  header, sys->stat_back_inval_dirty);
+    printf("\n%s_VICTIM_FILLS  \t\t : %10llu",  header, sys->stat_victim_fills);
+  }
+  if(sys->cfg.sim_mode!=SIM_MODE_A && sys->cfg.dcache_ports){
+    printf("\n%s_DCACHE_PORT_CONFLICTS\t : %10llu",  header, sys->stat_dcache_port_conflicts);
+    printf("\n%s_DCACHE_BANK_CONFLICTS\t : %10llu",  header, sys->stat_dcache_bank_conflicts);
+    printf("\n%s_DCACHE_PORT_WAIT\t\t : %10llu",  header, sys->stat_dcache_port_wait);
+  }
   printf("\n");
+}
+
+void memsys_print_stats(Memsys *sys)
+{
+  char header[256];
+  sprintf(header, "MEMSYS");
 
-  cache_print_stats(sys->dcache, "DCACHE");
+  memsys_print_access_stats(sys, header);
 
-  if(SIM_MODE!=SIM_MODE_A){
+  if(sys->interval){
+    memsys_interval_tick(sys, TRUE);
+  }
+
+  if(sys->hier){
+    hier_print_stats(sys->hier);
+  } else {
+    cache_print_stats(sys->dcache, "DCACHE");
+  }
+
+  if(sys->cfg.sim_mode!=SIM_MODE_A && sys->hier == NULL){
     cache_print_stats(sys->icache, "ICACHE");
+    if(sys->dcache->way_pred){
+      cache_print_way_pred_stats(sys->dcache, "DCACHE");
+    }
+    if(sys->icache->way_pred){
+      cache_print_way_pred_stats(sys->icache, "ICACHE");
+    }
+    if(sys->vcache){
+      cache_print_stats(sys->vcache, "VCACHE");
+    }
     cache_print_stats(sys->l2cache, "L2CACHE");
-    dram_print_stats(sys->dram);
+    if(sys->l2cache->set_sampled){
+      cache_print_sampling_stats(sys->l2cache, "L2CACHE");
+    }
+    if(sys->cfg.sectors > 1){
+      uns64 l2_bytes, dram_bytes;
+      memsys_traffic(sys, &l2_bytes, &dram_bytes);
+      cache_print_sector_stats(sys->dcache, "DCACHE");
+      cache_print_sector_stats(sys->icache, "ICACHE");
+      cache_print_sector_stats(sys->l2cache, "L2CACHE");
+      printf("\n%s_L2_TRAFFIC_BYTES\t\t : %10llu", header, l2_bytes);
+      printf("\n%s_DRAM_TRAFFIC_BYTES\t : %10llu", header, dram_bytes);
+      printf("\n");
+    }
+  }
+
+  if(sys->cfg.sim_mode!=SIM_MODE_A){
+    if(sys->dramctrl){
+      dramctrl_print_stats(sys->dramctrl);
+    } else {
+      dram_print_stats(sys->dram);
+    }
+    if(sys->tlb){
+      tlb_print_stats(sys->tlb, "TLB");
+    }
+  }
+
+  if(sys->events){
+    printf("\n%s_CYCLES        \t\t : %10llu", header, memsys_cycles(sys));
+    printf("\n");
+    mshr_print_stats(sys->dcache_mshr, "DCACHE_MSHR");
+    mshr_print_stats(sys->l2cache_mshr, "L2CACHE_MSHR");
+  }
+
+  if(sys->dcache_wbuf){
+    writebuf_print_stats(sys->dcache_wbuf, "DCACHE_WBUF");
+  }
+
+  if(sys->dcache_pf){
+    prefetcher_print_stats(sys->dcache_pf, "DCACHE_PF");
+  }
+  if(sys->icache_pf){
+    prefetcher_print_stats(sys->icache_pf, "ICACHE_PF");
+  }
+  if(sys->l2cache_pf){
+    prefetcher_print_stats(sys->l2cache_pf, "L2CACHE_PF");
+  }
+
+  if(sys->hier && sys->dcache->threec){
+    for(uns64 i = 0; i < sys->hier->num_levels; i++){
+      cache_print_threec_stats(sys->hier->level[i].cache, sys->hier->level[i].name);
+    }
+  } else if(sys->dcache->threec){
+    cache_print_threec_stats(sys->dcache, "DCACHE");
+    if(sys->cfg.sim_mode!=SIM_MODE_A){
+      cache_print_threec_stats(sys->icache, "ICACHE");
+      cache_print_threec_stats(sys->l2cache, "L2CACHE");
+    }
+  }
+
+  if(sys->sd_dcache){
+    stackdist_print_stats(sys->sd_dcache, "DCACHE_SD", sys->cfg.linesize);
+  }
+  if(sys->sd_icache){
+    stackdist_print_stats(sys->sd_icache, "ICACHE_SD", sys->cfg.linesize);
+    stackdist_print_stats(sys->sd_l2cache, "L2CACHE_SD", sys->cfg.linesize);
+  }
+
+  if(sys->rd_dcache){
+    reuse_print_stats(sys->rd_dcache, "DCACHE_RD");
+  }
+  if(sys->rd_icache){
+    reuse_print_stats(sys->rd_icache, "ICACHE_RD");
+    reuse_print_stats(sys->rd_l2cache, "L2CACHE_RD");
   }
 
 }
@@ -168,16 +1035,582 @@ uns64 memsys_access_modeA(Memsys *sys, Addr lineaddr, Access_Type type){
 // --------------- DO NOT CHANGE THE CODE ABOVE THIS LINE ----------
 ////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////
+// Main memory access at cycle now: the banked controller when one is
+// configured, else the flat dram_access() latency
+////////////////////////////////////////////////////////////////////
+
+static uns64 memsys_dram_access(Memsys *sys, Addr lineaddr, Flag is_write, uns64 now){
+  if (sys -> dramctrl) {
+    return dramctrl_access(sys -> dramctrl, lineaddr, is_write, now);
+  }
+  return dram_access(sys -> dram, lineaddr, is_write);
+}
+
+// Extra L1 hit latency when the hit was not in the predicted way
+static uns64 memsys_way_mispredict(Cache *c){
+  return c -> last_way_mispredict ? WAY_MISPREDICT_LATENCY : 0;
+}
+
+////////////////////////////////////////////////////////////////////
+// DCACHE ports and banks (cfg.dcache_ports > 0). Data accesses issue
+// in order; up to dcache_ports of them share a cycle, as long as no
+// two need the same bank for different lines (two to the same line
+// are served together). Banks are DCACHE_BANK_BYTES wide and
+// interleaved by byte address. Returns the cycle, no earlier than
+// now, at which the access being simulated gets its port and bank.
+////////////////////////////////////////////////////////////////////
+
+static uns64 memsys_dcache_port(Memsys *sys, Addr lineaddr, uns64 now){
+  uns64 start = now;
+  Flag port_conflict = FALSE;
+  Flag bank_conflict = FALSE;
+  uns64 bank = 0;
+  if (sys -> dcache_bank_cycle) {
+    bank = (sys -> access_addr / DCACHE_BANK_BYTES) % sys -> cfg.dcache_banks;
+  }
+
+  if (now < sys -> dcache_port_cycle) {
+    now = sys -> dcache_port_cycle;
+  }
+  for (;;) {
+    if (now != sys -> dcache_port_cycle) {
+      sys -> dcache_port_cycle = now;
+      sys -> dcache_ports_used = 0;
+    }
+    if (sys -> dcache_ports_used == sys -> cfg.dcache_ports) {
+      port_conflict = TRUE;
+    } else if (sys -> dcache_bank_cycle && sys -> dcache_bank_cycle[bank] == now
+               && sys -> dcache_bank_line[bank] != lineaddr) {
+      bank_conflict = TRUE;
+    } else {
+      break;
+    }
+    now++;
+  }
+
+  sys -> dcache_ports_used++;
+  if (sys -> dcache_bank_cycle) {
+    sys -> dcache_bank_cycle[bank] = now;
+    sys -> dcache_bank_line[bank] = lineaddr;
+  }
+  if (port_conflict) {
+    sys -> stat_dcache_port_conflicts++;
+  }
+  if (bank_conflict) {
+    sys -> stat_dcache_bank_conflicts++;
+  }
+  sys -> stat_dcache_port_wait += now - start;
+  return now;
+}
+
+// Blocking modes: the cycles a data access waits for its port and bank
+static uns64 memsys_dcache_port_wait(Memsys *sys, Addr lineaddr){
+  if (sys -> cfg.dcache_ports == 0) {
+    return 0;
+  }
+  return memsys_dcache_port(sys, lineaddr, sys -> clock) - sys -> clock;
+}
+
+// After any install: a prefetched line leaving unused was pollution
+static void memsys_check_victim(Cache *c, Prefetcher *pf){
+  if (pf && c -> last_evicted_line.valid && c -> last_evicted_line.prefetched) {
+    pf -> stat_polluting++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// L1/L2 inclusion (cfg.l2cache_inclusion), applied to the victims of
+// every install:
+//  NINE      - L1 dirty victims are written back to the L2, L2 dirty
+//              victims to DRAM; nothing else moves
+//  INCLUSIVE - as NINE, and an L2 victim is back-invalidated in both
+//              L1s; a dirty L1 copy goes to DRAM with it
+//  EXCLUSIVE - every L1 victim, clean or dirty, fills the L2, after
+//              the L1's read of the new line. An L2 read hit moves
+//              the line up to the L1 (see memsys_L2_access), so no
+//              line is in both levels
+////////////////////////////////////////////////////////////////////
+
+static void memsys_L2_evict(Memsys *sys){
+  Cache_Line *victim = &sys -> l2cache -> last_evicted_line;
+  if (!victim -> valid) {
+    return;
+  }
+  Flag dirty = victim -> dirty;
+  victim -> valid = FALSE;
+  victim -> dirty = FALSE;
+
+  if (sys -> cfg.l2cache_inclusion == INCLUSION_INCLUSIVE) {
+    Flag l1_dirty;
+    if (cache_invalidate(sys -> dcache, victim -> tag, &l1_dirty) == HIT) {
+      sys -> stat_back_invals++;
+      if (l1_dirty) {
+        sys -> stat_back_inval_dirty++;
+        dirty = TRUE;
+      }
+    }
+    if (cache_invalidate(sys -> icache, victim -> tag, &l1_dirty) == HIT) {
+      sys -> stat_back_invals++;
+    }
+    if (sys -> vcache && cache_invalidate(sys -> vcache, victim -> tag, &l1_dirty) == HIT) {
+      sys -> stat_back_invals++;
+      if (l1_dirty) {
+        sys -> stat_back_inval_dirty++;
+        dirty = TRUE;
+      }
+    }
+  }
+  if (dirty) {
+    // one DRAM write per dirty sector, the whole line when not sectored
+    int writes = (sys -> l2cache -> num_sectors > 1) ? __builtin_popcount(victim -> sector_dirty) : 1;
+    for (int i = 0; i < writes; i++) {
+      memsys_dram_access(sys, victim -> tag, 1, sys -> clock);
+    }
+  }
+}
+
+// Exclusive: an L1 victim fills the L2, without a DRAM read
+static void memsys_L2_victim_fill(Memsys *sys, Addr lineaddr, Flag dirty){
+  sys -> stat_victim_fills++;
+  if (cache_probe(sys -> l2cache, lineaddr) == HIT) {
+    if (dirty) {
+      cache_mark_dirty(sys -> l2cache, lineaddr);
+    }
+    return;
+  }
+  cache_install(sys -> l2cache, lineaddr, dirty);
+  memsys_check_victim(sys -> l2cache, sys -> l2cache_pf);
+  memsys_L2_evict(sys);
+}
+
+// A dirty L1 victim goes to the L2 one dirty sector at a time, or as
+// one line when not sectored
+static void memsys_L1_writeback(Memsys *sys, Cache *c, Cache_Line *victim){
+  if (c -> num_sectors == 1) {
+    memsys_L2_access(sys, victim -> tag, 1);
+    return;
+  }
+  uns sector = sys -> access_sector;
+  for (uns s = 0; s < c -> num_sectors; s++) {
+    if (victim -> sector_dirty & (1u << s)) {
+      sys -> access_sector = s;
+      memsys_L2_access(sys, victim -> tag, 1);
+    }
+  }
+  sys -> access_sector = sector;
+}
+
+static void memsys_L1_evict(Memsys *sys, Cache *c){
+  Cache_Line victim = c -> last_evicted_line;
+  if (!victim.valid) {
+    return;
+  }
+  c -> last_evicted_line.valid = FALSE;
+  c -> last_evicted_line.dirty = FALSE;
+
+  // DCACHE victims, clean or dirty, go to the victim cache, and the
+  // line that makes room there takes the usual way down
+  if (c == sys -> dcache && sys -> vcache) {
+    cache_install(sys -> vcache, victim.tag, victim.dirty);
+    memsys_L1_evict(sys, sys -> vcache);
+    return;
+  }
+
+  if (sys -> cfg.l2cache_inclusion == INCLUSION_EXCLUSIVE) {
+    memsys_L2_victim_fill(sys, victim.tag, victim.dirty);
+  } else if (victim.dirty) {
+    memsys_L1_writeback(sys, c, &victim);
+  }
+}
+
+static void memsys_evict(Memsys *sys, Cache *c){
+  if (c == sys -> l2cache) {
+    memsys_L2_evict(sys);
+  } else {
+    memsys_L1_evict(sys, c);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// DCACHE miss: look in the victim cache. On a hit the line moves back
+// into the DCACHE, the DCACHE victim takes its place, and TRUE is
+// returned. The lookup overlaps the L2 request, so a miss costs nothing.
+////////////////////////////////////////////////////////////////////
+
+static Flag memsys_vcache_swap(Memsys *sys, Addr lineaddr, Flag mark_dirty){
+  if (sys -> vcache == NULL || cache_access(sys -> vcache, lineaddr, mark_dirty) == MISS) {
+    return FALSE;
+  }
+  Flag dirty;
+  cache_invalidate(sys -> vcache, lineaddr, &dirty);
+  cache_install(sys -> dcache, lineaddr, dirty);
+  memsys_check_victim(sys -> dcache, sys -> dcache_pf);
+  memsys_L1_evict(sys, sys -> dcache);
+  return TRUE;
+}
+
+// L2 set sampling: what an access to an unsampled set is charged on
+// top of the hit latency. A moving average rather than the mean of
+// the whole run, which the cold start would skew for a long time.
+static uns64 memsys_L2_sampled_delay(Memsys *sys, uns kind){
+  return (sys -> l2_sampled_delay[kind] + L2_SAMPLE_SCALE / 2) / L2_SAMPLE_SCALE;
+}
+
+// Banked shared L2 (multicore): wait for the line's bank, then hold it
+static uns64 memsys_L2_bank_wait(Memsys *sys, Addr lineaddr){
+  uns64 *bank_free = &sys -> l2cache_bank_free[lineaddr % sys -> cfg.l2cache_banks];
+  uns64 wait = (*bank_free > sys -> clock) ? *bank_free - sys -> clock : 0;
+  *bank_free = sys -> clock + wait + L2CACHE_BANK_BUSY;
+  sys -> stat_l2_bank_wait += wait;
+  return wait;
+}
+
+////////////////////////////////////////////////////////////////////
+// DCACHE write policy (modes B/C, blocking). A store that does not
+// stay in the DCACHE (write-through, or a write-no-allocate miss)
+// writes the L2: through the write buffer if there is one, where it
+// only waits for a free entry, else directly, paying the L2 access.
+////////////////////////////////////////////////////////////////////
+
+static uns64 memsys_L2_write(Memsys *sys, Addr lineaddr){
+  if (sys -> dcache_wbuf == NULL) {
+    return memsys_L2_access(sys, lineaddr, 1);
+  }
+  Flag merged;
+  uns64 stall = writebuf_insert(sys -> dcache_wbuf, lineaddr, sys -> clock, &merged);
+  if (!merged) {
+    memsys_L2_access(sys, lineaddr, 1);
+  }
+  return stall;
+}
+
+// A DCACHE read of lineaddr from the L2 first waits for a buffered write to it
+static uns64 memsys_L2_read_wait(Memsys *sys, Addr lineaddr){
+  if (sys -> dcache_wbuf == NULL) {
+    return 0;
+  }
+  return writebuf_read_wait(sys -> dcache_wbuf, lineaddr, sys -> clock);
+}
+
+// Exclusive: a line moved up from the L2 keeps its dirty bit
+static void memsys_L1_fill_dirty(Memsys *sys, Cache *c, Addr lineaddr){
+  if (sys -> l2_line_dirty) {
+    sys -> l2_line_dirty = FALSE;
+    cache_mark_dirty(c, lineaddr);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Prefetch support for mode B/C. A prefetch fill is off the critical
+// path: its latency only decides when the line becomes usable.
+////////////////////////////////////////////////////////////////////
+
+// After a demand hit: credit the prefetcher, return any wait for a late fill
+static uns64 memsys_prefetch_hit(Memsys *sys, Cache *c, Prefetcher *pf, Addr lineaddr){
+  if (pf == NULL || !c -> last_hit_prefetched) {
+    return 0;
+  }
+  return prefetcher_useful(pf, lineaddr, sys -> clock);
+}
+
+static void memsys_prefetch(Memsys *sys, Cache *c, Prefetcher *pf, Addr lineaddr, Flag trigger){
+  Addr candidates[PREFETCH_MAX_DEGREE];
+  uns num = prefetcher_observe(pf, lineaddr, sys -> access_pc, trigger, candidates);
+
+  for (uns i = 0; i < num; i++) {
+    Addr pfaddr = candidates[i];
+    if (cache_probe(c, pfaddr) == HIT) {
+      continue;
+    }
+    uns64 latency;
+    if (c == sys -> l2cache) {
+      latency = memsys_dram_access(sys, pfaddr, 0, sys -> clock);
+    } else {
+      latency = memsys_L2_access(sys, pfaddr, 0);
+    }
+    cache_install_prefetch(c, pfaddr);
+    if (c != sys -> l2cache) {
+      memsys_L1_fill_dirty(sys, c, pfaddr);
+    }
+    memsys_check_victim(c, pf);
+    memsys_evict(sys, c);
+    prefetcher_issued(pf, pfaddr, sys -> clock + latency);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Hierarchy from a file (sys -> hier): an access enters at the level
+// that serves its type and goes down the next chain as far as it
+// misses. Every level is write-back, write-allocate and blocking, and
+// handles a miss the way memsys_L2_access does: install, write a
+// dirty victim back to the level below, then read the line from it.
+// Writebacks, as in modeBC, take no time.
+////////////////////////////////////////////////////////////////////
+
+static uns64 memsys_level_access(Memsys *sys, int i, Addr lineaddr, Flag mark_dirty, Addr pc){
+  Hier_Level *l = &sys -> hier -> level[i];
+  if (l -> cache == sys -> l2cache) {
+    if (sys -> sd_l2cache) {
+      stackdist_access(sys -> sd_l2cache, lineaddr, mark_dirty ? ACCESS_TYPE_STORE : ACCESS_TYPE_LOAD);
+    }
+    if (sys -> rd_l2cache) {
+      reuse_access(sys -> rd_l2cache, lineaddr, mark_dirty ? ACCESS_TYPE_STORE : sys -> access_type);
+    }
+  }
+  Flag out = cache_access_pc(l -> cache, lineaddr, mark_dirty, pc);
+  uns64 delay = l -> latency + memsys_way_mispredict(l -> cache);
+  if (out == HIT) {
+    return delay;
+  }
+
+  cache_install(l -> cache, lineaddr, mark_dirty);
+  Cache_Line victim = l -> cache -> last_evicted_line;
+  l -> cache -> last_evicted_line.valid = FALSE;
+  l -> cache -> last_evicted_line.dirty = FALSE;
+  if (victim.valid && victim.dirty) {
+    if (l -> next == HIER_DRAM) {
+      memsys_dram_access(sys, victim.tag, 1, sys -> clock);
+    } else {
+      memsys_level_access(sys, l -> next, victim.tag, 1, 0);
+    }
+  }
+  if (l -> next == HIER_DRAM) {
+    return delay + memsys_dram_access(sys, lineaddr, 0, sys -> clock);
+  }
+  return delay + memsys_level_access(sys, l -> next, lineaddr, 0, 0);
+}
+
+uns64 memsys_access_hier(Memsys *sys, Addr lineaddr, Access_Type type){
+  if (type == ACCESS_TYPE_IFETCH) {
+    return memsys_level_access(sys, sys -> hier -> ifetch_top, lineaddr, FALSE, sys -> access_pc);
+  }
+  uns64 delay = memsys_dcache_port_wait(sys, lineaddr);
+  return delay + memsys_level_access(sys, sys -> hier -> data_top, lineaddr, type == ACCESS_TYPE_STORE,
+                                     sys -> access_pc);
+}
+
+// Functional counterpart of memsys_level_access
+static void memsys_warm_level(Memsys *sys, int i, Addr lineaddr, Flag mark_dirty){
+  Hier_Level *l = &sys -> hier -> level[i];
+  if (cache_warm(l -> cache, lineaddr, 0, mark_dirty) == HIT) {
+    return;
+  }
+  Cache_Line victim = l -> cache -> last_evicted_line;
+  l -> cache -> last_evicted_line.valid = FALSE;
+  if (l -> next == HIER_DRAM) {
+    return;
+  }
+  if (victim.valid && victim.dirty) {
+    memsys_warm_level(sys, l -> next, victim.tag, TRUE);
+  }
+  memsys_warm_level(sys, l -> next, lineaddr, FALSE);
+}
+
+////////////////////////////////////////////////////////////////////
+// Address translation (sys -> tlb, see tlb.h). A walk loads one PTE
+// per level, root first, each depending on the last, through the same
+// path as a demand load. The walk's loads are not demand accesses: they
+// show up in the cache stats but not in the MEMSYS access counts, and
+// they carry no PC for the prefetchers.
+////////////////////////////////////////////////////////////////////
+
+static uns64 memsys_page_walk(Memsys *sys, Addr addr, Flag functional){
+  Addr pte[TLB_MAX_LEVELS];
+  uns levels = tlb_walk_addrs(sys -> tlb, addr, pte);
+  Addr pc = sys -> access_pc;
+  Addr vaddr = sys -> access_addr;
+  Access_Type type = sys -> access_type;
+  uns sector = sys -> access_sector;
+  uns64 delay = 0;
+
+  sys -> access_pc = 0;
+  sys -> access_type = ACCESS_TYPE_LOAD;
+  for (uns i = 0; i < levels; i++) {
+    Addr lineaddr = pte[i] / sys -> cfg.linesize;
+    sys -> access_addr = pte[i];
+    if (sys -> cfg.sectors > 1) {
+      sys -> access_sector = (pte[i] % sys -> cfg.linesize) / (sys -> cfg.linesize / sys -> cfg.sectors);
+    }
+    if (functional) {
+      memsys_access_functional(sys, lineaddr, ACCESS_TYPE_LOAD);
+      continue;
+    }
+    uns64 d;
+    if (sys -> hier) {
+      d = memsys_access_hier(sys, lineaddr, ACCESS_TYPE_LOAD);
+    } else {
+      d = memsys_access_modeBC(sys, lineaddr, ACCESS_TYPE_LOAD);
+    }
+    sys -> clock += d;
+    delay = delay + d;
+  }
+  sys -> access_pc = pc;
+  sys -> access_addr = vaddr;
+  sys -> access_type = type;
+  sys -> access_sector = sector;
+
+  if (!functional) {
+    sys -> tlb -> stat_walk_accesses += levels;
+    sys -> tlb -> stat_walk_delay += delay;
+    sys -> tlb -> stat_delay += delay;
+  }
+  return delay;
+}
+
+// Returns the translation delay of addr, and advances the clock past it
+uns64 memsys_translate(Memsys *sys, Addr addr, Access_Type type){
+  uns64 delay;
+  Flag out = tlb_access(sys -> tlb, addr, type, &delay);
+  sys -> clock += delay;
+  if (out == MISS) {
+    delay = delay + memsys_page_walk(sys, addr, FALSE);
+  }
+  return delay;
+}
+
+void memsys_translate_functional(Memsys *sys, Addr addr, Access_Type type){
+  if (tlb_warm(sys -> tlb, addr, type) == MISS) {
+    memsys_page_walk(sys, addr, TRUE);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Functional access, for warmup and for skipping between measured
+// regions: tags, dirty bits and replacement state change as in a
+// timed access, but no stats, delays, DRAM, prefetchers or MSHRs are
+// touched. Lines move between the caches as in a timed access: L1
+// victims go through the victim cache, fill an exclusive L2 or have
+// their dirty bit written back, an exclusive L2 hit moves the line
+// up, and an inclusive L2 victim leaves the L1s. What would be
+// written to DRAM is dropped. The DCACHE write policy is followed.
+// Each cache's 3C shadow state follows along, see cache_warm.
+////////////////////////////////////////////////////////////////////
+
+static void memsys_warm_L2(Memsys *sys, Addr lineaddr, uns sector, Flag dirty){
+  cache_warm(sys -> l2cache, lineaddr, sector, dirty);
+  Cache_Line *victim = &sys -> l2cache -> last_evicted_line;
+  if (victim -> valid && sys -> cfg.l2cache_inclusion == INCLUSION_INCLUSIVE) {
+    Flag l1_dirty;
+    cache_invalidate(sys -> dcache, victim -> tag, &l1_dirty);
+    cache_invalidate(sys -> icache, victim -> tag, &l1_dirty);
+    if (sys -> vcache) {
+      cache_invalidate(sys -> vcache, victim -> tag, &l1_dirty);
+    }
+  }
+  victim -> valid = FALSE;
+}
+
+// The victim of the fill just made in c, moved as memsys_L1_evict does
+static void memsys_warm_L1_victim(Memsys *sys, Cache *c){
+  Cache_Line victim = c -> last_evicted_line;
+  c -> last_evicted_line.valid = FALSE;
+  if (!victim.valid) {
+    return;
+  }
+  if (c == sys -> dcache && sys -> vcache) {
+    cache_warm(sys -> vcache, victim.tag, 0, victim.dirty);
+    memsys_warm_L1_victim(sys, sys -> vcache);
+    return;
+  }
+  if (sys -> cfg.l2cache_inclusion == INCLUSION_EXCLUSIVE) {
+    if (cache_probe(sys -> l2cache, victim.tag) == MISS) {
+      memsys_warm_L2(sys, victim.tag, 0, victim.dirty);
+    } else if (victim.dirty) {
+      cache_mark_dirty(sys -> l2cache, victim.tag);
+    }
+    return;
+  }
+  if (victim.dirty) {
+    for (uns s = 0; s < c -> num_sectors; s++) {
+      if (victim.sector_dirty & (1u << s)) {
+        memsys_warm_L2(sys, victim.tag, s, TRUE);
+      }
+    }
+  }
+}
+
+static void memsys_warm_L1(Memsys *sys, Cache *c, Addr lineaddr, Flag mark_dirty){
+  Flag dirty;
+  if (c == sys -> dcache && sys -> vcache && cache_probe(c, lineaddr) == MISS
+      && cache_invalidate(sys -> vcache, lineaddr, &dirty) == HIT) {
+    // the victim cache hands the line back, as in memsys_vcache_swap
+    cache_warm(c, lineaddr, 0, mark_dirty || dirty);
+    memsys_warm_L1_victim(sys, c);
+    return;
+  }
+  if (cache_warm(c, lineaddr, sys -> access_sector, mark_dirty) == HIT) {
+    return;
+  }
+  if (sys -> cfg.sim_mode == SIM_MODE_A) {
+    c -> last_evicted_line.valid = FALSE;
+    return;
+  }
+  if (sys -> cfg.l2cache_inclusion != INCLUSION_EXCLUSIVE) {
+    // the writeback reaches the L2 before the read, as in modeBC
+    memsys_warm_L1_victim(sys, c);
+    memsys_warm_L2(sys, lineaddr, sys -> access_sector, FALSE);
+    return;
+  }
+  // exclusive: an L2 hit moves the line up, then the victim goes down
+  if (cache_probe(sys -> l2cache, lineaddr) == HIT) {
+    cache_warm(sys -> l2cache, lineaddr, 0, FALSE);
+    cache_invalidate(sys -> l2cache, lineaddr, &dirty);
+    if (dirty) {
+      cache_mark_dirty(c, lineaddr);
+    }
+  }
+  memsys_warm_L1_victim(sys, c);
+}
+
+void memsys_access_functional(Memsys *sys, Addr lineaddr, Access_Type type){
+  Flag has_l2 = (sys -> cfg.sim_mode != SIM_MODE_A);
+  if (sys -> hier) {
+    int top = (type == ACCESS_TYPE_IFETCH) ? sys -> hier -> ifetch_top : sys -> hier -> data_top;
+    memsys_warm_level(sys, top, lineaddr, type == ACCESS_TYPE_STORE);
+    return;
+  }
+  if (type == ACCESS_TYPE_IFETCH) {
+    if (has_l2) {
+      memsys_warm_L1(sys, sys -> icache, lineaddr, FALSE);
+    }
+    return;
+  }
+  Flag store = (type == ACCESS_TYPE_STORE);
+  if (store && has_l2 && sys -> cfg.dcache_write_miss == WRITE_NO_ALLOCATE
+      && cache_probe(sys -> dcache, lineaddr) == MISS) {
+    memsys_warm_L2(sys, lineaddr, sys -> access_sector, TRUE);
+    return;
+  }
+  Flag through = store && has_l2 && sys -> cfg.dcache_write_through;
+  memsys_warm_L1(sys, sys -> dcache, lineaddr, store && !through);
+  if (through) {
+    memsys_warm_L2(sys, lineaddr, sys -> access_sector, TRUE);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
 uns64 memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type){
   uns64 delay = 0;
   Flag needs_dcache_access = FALSE;
   Flag mark_dirty = FALSE;
   if (type == ACCESS_TYPE_IFETCH){
-    Flag out = cache_access(sys -> icache, lineaddr, 0);
-    delay = ICACHE_HIT_LATENCY;
+    Flag out = cache_access_sector(sys -> icache, lineaddr, sys -> access_sector, 0, sys -> access_pc);
+    delay = ICACHE_HIT_LATENCY + memsys_way_mispredict(sys -> icache);
     if (out == MISS) {
       delay = delay + memsys_L2_access(sys, lineaddr, 0);
-      cache_install(sys -> icache, lineaddr, 0);
+      cache_install_sector(sys -> icache, lineaddr, sys -> access_sector, 0);
+      memsys_L1_fill_dirty(sys, sys -> icache, lineaddr);
+      memsys_check_victim(sys -> icache, sys -> icache_pf);
+      memsys_L1_evict(sys, sys -> icache);
+    } else {
+      delay = delay + memsys_prefetch_hit(sys, sys -> icache, sys -> icache_pf, lineaddr);
+    }
+    if (sys -> icache_pf) {
+      memsys_prefetch(sys, sys -> icache, sys -> icache_pf, lineaddr,
+                      out == MISS || sys -> icache -> last_hit_prefetched);
     }
   }
   if (type == ACCESS_TYPE_LOAD){
@@ -189,17 +1622,53 @@ uns64 memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type){
     mark_dirty = TRUE;
   }
   if (needs_dcache_access) {
-    Flag out = cache_access(sys -> dcache, lineaddr, mark_dirty);
-    if (out == MISS) {
-      cache_install(sys -> dcache, lineaddr, mark_dirty);
-      if (sys -> dcache -> last_evicted_line.valid) {
-        if (sys -> dcache -> last_evicted_line.dirty) {
-          sys -> dcache -> last_evicted_line.dirty = FALSE;
-          sys -> dcache -> last_evicted_line.valid = FALSE;
-          memsys_L2_access(sys, sys-> dcache -> last_evicted_line.tag, 1);
-        }
+    delay = memsys_dcache_port_wait(sys, lineaddr);
+    Flag out = cache_access_sector(sys -> dcache, lineaddr, sys -> access_sector, mark_dirty, sys -> access_pc);
+    delay = delay + memsys_way_mispredict(sys -> dcache);
+    Flag allocate = !mark_dirty || sys -> cfg.dcache_write_miss == WRITE_ALLOCATE;
+    if (out == MISS && memsys_vcache_swap(sys, lineaddr, mark_dirty)) {
+      delay = delay + VCACHE_HIT_LATENCY;
+    } else if (out == MISS && allocate) {
+      // the victim goes down before the read, except into an exclusive
+      // L2, where it could displace the very line being read
+      Flag exclusive = (sys -> cfg.l2cache_inclusion == INCLUSION_EXCLUSIVE);
+      cache_install_sector(sys -> dcache, lineaddr, sys -> access_sector, mark_dirty);
+      memsys_check_victim(sys -> dcache, sys -> dcache_pf);
+      if (!exclusive) {
+        memsys_L1_evict(sys, sys -> dcache);
       }
+      delay = delay + memsys_L2_read_wait(sys, lineaddr);
       delay = delay + memsys_L2_access(sys, lineaddr, 0);
+      memsys_L1_fill_dirty(sys, sys -> dcache, lineaddr);
+      if (exclusive) {
+        memsys_L1_evict(sys, sys -> dcache);
+      }
+    } else if (out == MISS) {
+      // store miss: write-validate installs the line without reading
+      // it from the L2, write-no-allocate leaves the DCACHE alone
+      if (sys -> cfg.dcache_write_miss == WRITE_VALIDATE) {
+        cache_install_sector(sys -> dcache, lineaddr, sys -> access_sector, mark_dirty);
+        memsys_check_victim(sys -> dcache, sys -> dcache_pf);
+        memsys_L1_evict(sys, sys -> dcache);
+      }
+    } else {
+      delay = delay + memsys_prefetch_hit(sys, sys -> dcache, sys -> dcache_pf, lineaddr);
+    }
+    if (mark_dirty && sys -> cfg.dcache_write_through) {
+      // the DCACHE copy stays clean, the L2 gets every store
+      Cache_Line *line = cache_find_line(sys -> dcache, lineaddr);
+      if (line) {
+        line -> dirty = FALSE;
+        line -> sector_dirty = 0;
+      }
+    }
+    if (mark_dirty && (sys -> cfg.dcache_write_through
+                       || (out == MISS && !allocate && cache_probe(sys -> dcache, lineaddr) == MISS))) {
+      delay = delay + memsys_L2_write(sys, lineaddr);
+    }
+    if (sys -> dcache_pf) {
+      memsys_prefetch(sys, sys -> dcache, sys -> dcache_pf, lineaddr,
+                      out == MISS || sys -> dcache -> last_hit_prefetched);
     }
   }
   return delay;
@@ -215,24 +1684,197 @@ uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback){
   uns64 delay = L2CACHE_HIT_LATENCY;
   Flag out;
 
+  if (sys -> l2cache_bank_free) {
+    delay = delay + memsys_L2_bank_wait(sys, lineaddr);
+  }
+
   int num = 0;
   if (is_writeback == 1) {
     num = 1;
   }
-  out = cache_access(sys -> l2cache, lineaddr, num);
+  if (sys -> sd_l2cache) {
+    // the L2 stream has no access type, record reads as loads
+    stackdist_access(sys -> sd_l2cache, lineaddr, num ? ACCESS_TYPE_STORE : ACCESS_TYPE_LOAD);
+  }
+  if (sys -> rd_l2cache) {
+    reuse_access(sys -> rd_l2cache, lineaddr, num ? ACCESS_TYPE_STORE : sys -> access_type);
+  }
+  uns kind = num ? NUM_ACCESS_TYPES : sys -> access_type;
+  if (cache_skip(sys -> l2cache, lineaddr, num)) {
+    return delay + memsys_L2_sampled_delay(sys, kind);
+  }
+  uns64 hit_delay = delay;
+  Flag exclusive = (sys -> cfg.l2cache_inclusion == INCLUSION_EXCLUSIVE);
+  sys -> l2_line_dirty = FALSE;
+  out = cache_access_sector(sys -> l2cache, lineaddr, sys -> access_sector, num, 0);
   if (out == MISS) {
-    cache_install(sys -> l2cache, lineaddr, num);
-    if (sys -> l2cache -> last_evicted_line.valid) {
-      if (sys -> l2cache -> last_evicted_line.dirty) {
-        sys -> l2cache -> last_evicted_line.dirty = FALSE;
-        sys -> l2cache -> last_evicted_line.valid = FALSE;
-        dram_access(sys -> dram, sys -> l2cache -> last_evicted_line.tag, 1);
-      }
+    // exclusive: a read miss fills only the L1
+    if (!exclusive || is_writeback) {
+      cache_install_sector(sys -> l2cache, lineaddr, sys -> access_sector, num);
+      memsys_check_victim(sys -> l2cache, sys -> l2cache_pf);
+      memsys_L2_evict(sys);
     }
-    delay = delay + dram_access(sys -> dram, lineaddr, 0);
+    delay = delay + memsys_dram_access(sys, lineaddr, 0, sys -> clock);
+  } else if (!is_writeback) {
+    delay = delay + memsys_prefetch_hit(sys, sys -> l2cache, sys -> l2cache_pf, lineaddr);
+    if (exclusive) {
+      cache_invalidate(sys -> l2cache, lineaddr, &sys -> l2_line_dirty);
+    }
+  }
+  // the L2 prefetcher trains on reads only, not on L1 writebacks
+  if (sys -> l2cache_pf && !is_writeback) {
+    memsys_prefetch(sys, sys -> l2cache, sys -> l2cache_pf, lineaddr,
+                    out == MISS || sys -> l2cache -> last_hit_prefetched);
+  }
+  if (sys -> l2cache -> set_sampled) {
+    int64 *avg = &sys -> l2_sampled_delay[kind];
+    *avg += ((int64) (delay - hit_delay) * L2_SAMPLE_SCALE - *avg) / (1 << L2_SAMPLE_DECAY);
   }
   //To get the delay of L2 MISS, you must use the dram_access() function
   //To perform writebacks to memory, you must use the dram_access() function
   //This will help us track your memory reads and memory writes
   return delay;
 }
+
+
+/////////////////////////////////////////////////////////////////////
+// Non-blocking timing model (cfg.dcache_mshrs > 0)
+//
+// One access issues per cycle, at sys->clock (with cfg.dcache_ports,
+// up to that many loads and stores share a cycle). Loads and stores do not
+// wait for their misses: a DCACHE miss takes an MSHR and its fill is
+// scheduled as an event, so independent misses overlap. The core only
+// stalls when it needs an MSHR and none is free, or on an ICACHE miss
+// (fetch cannot go on without the line). Lines are installed when
+// their fill completes; until then further misses to the line merge
+// into its MSHR. The returned delay is issue-to-data for the access.
+// Writebacks are buffered and take no time.
+/////////////////////////////////////////////////////////////////////
+
+// Complete every fill due by cycle now
+static void memsys_nb_advance(Memsys *sys, uns64 now){
+  Event ev;
+  while (event_pop(sys -> events, now, &ev)) {
+    Cache *c = (ev.type == EVENT_L2CACHE_FILL) ? sys -> l2cache : sys -> dcache;
+    Flag dirty = (ev.type == EVENT_DCACHE_FILL) ? ev.mshr -> dirty : FALSE;
+    // a writeback may have brought the line in while the fill was in
+    // flight; stores merged into the MSHR still dirty it
+    if (cache_probe(c, ev.lineaddr) == HIT) {
+      if (dirty) {
+        cache_mark_dirty(c, ev.lineaddr);
+      }
+      continue;
+    }
+    cache_install(c, ev.lineaddr, dirty);
+    memsys_evict(sys, c);
+  }
+}
+
+// L2 read arriving at cycle now, returns the cycle the data is back
+static uns64 memsys_nb_L2_read(Memsys *sys, Addr lineaddr, uns64 now){
+  if (sys -> sd_l2cache) {
+    stackdist_access(sys -> sd_l2cache, lineaddr, ACCESS_TYPE_LOAD);
+  }
+  if (sys -> rd_l2cache) {
+    reuse_access(sys -> rd_l2cache, lineaddr, sys -> access_type);
+  }
+  if (cache_access(sys -> l2cache, lineaddr, FALSE) == HIT) {
+    return now + L2CACHE_HIT_LATENCY;
+  }
+
+  MSHR_Entry *e = mshr_find(sys -> l2cache_mshr, lineaddr, now);
+  if (e) {
+    sys -> l2cache_mshr -> stat_secondary++;
+    return e -> ready;
+  }
+
+  uns64 start = mshr_next_free(sys -> l2cache_mshr, now);
+  if (start > now) {
+    sys -> l2cache_mshr -> stat_full++;
+    sys -> l2cache_mshr -> stat_full_cycles += start - now;
+  }
+  uns64 ready = start + L2CACHE_HIT_LATENCY;
+  ready = ready + memsys_dram_access(sys, lineaddr, 0, ready);
+  e = mshr_alloc(sys -> l2cache_mshr, lineaddr, start, ready);
+  event_push(sys -> events, ready, EVENT_L2CACHE_FILL, lineaddr, e);
+  return ready;
+}
+
+uns64 memsys_access_nonblocking(Memsys *sys, Addr lineaddr, Access_Type type){
+  uns64 issue = sys -> clock;
+  uns64 now = issue;
+  uns64 ready;
+
+  memsys_nb_advance(sys, now);
+
+  if (type == ACCESS_TYPE_IFETCH) {
+    if (cache_access_pc(sys -> icache, lineaddr, FALSE, sys -> access_pc) == HIT) {
+      ready = now + ICACHE_HIT_LATENCY + memsys_way_mispredict(sys -> icache);
+    } else {
+      ready = memsys_nb_L2_read(sys, lineaddr, now + ICACHE_HIT_LATENCY);
+      now = ready;
+      memsys_nb_advance(sys, now);
+      cache_install(sys -> icache, lineaddr, FALSE);
+    }
+  } else {
+    Flag mark_dirty = (type == ACCESS_TYPE_STORE);
+    if (sys -> cfg.dcache_ports) {
+      now = memsys_dcache_port(sys, lineaddr, now);
+      memsys_nb_advance(sys, now);
+    }
+    if (cache_access_pc(sys -> dcache, lineaddr, mark_dirty, sys -> access_pc) == HIT) {
+      ready = now + DCACHE_HIT_LATENCY + memsys_way_mispredict(sys -> dcache);
+    } else if (memsys_vcache_swap(sys, lineaddr, mark_dirty)) {
+      ready = now + DCACHE_HIT_LATENCY + VCACHE_HIT_LATENCY;
+    } else {
+      MSHR_Entry *e = mshr_find(sys -> dcache_mshr, lineaddr, now);
+      if (e) {
+        sys -> dcache_mshr -> stat_secondary++;
+      } else {
+        uns64 start = mshr_next_free(sys -> dcache_mshr, now);
+        if (start > now) {
+          sys -> dcache_mshr -> stat_full++;
+          sys -> dcache_mshr -> stat_full_cycles += start - now;
+          now = start;
+          memsys_nb_advance(sys, now);
+        }
+        ready = memsys_nb_L2_read(sys, lineaddr, now + DCACHE_HIT_LATENCY);
+        e = mshr_alloc(sys -> dcache_mshr, lineaddr, now, ready);
+        event_push(sys -> events, ready, EVENT_DCACHE_FILL, lineaddr, e);
+      }
+      e -> dirty = e -> dirty || mark_dirty;
+      ready = e -> ready;
+    }
+  }
+
+  // with DCACHE ports, the next data access may issue in the same
+  // cycle; memsys_dcache_port() moves it on when the ports run out
+  if (type != ACCESS_TYPE_IFETCH && sys -> cfg.dcache_ports) {
+    sys -> clock = now;
+  } else {
+    sys -> clock = now + 1;
+  }
+  return ready - issue;
+}
+
+// Cycles to run the whole trace, including fills still in flight
+uns64 memsys_cycles(Memsys *sys){
+  if (sys -> events && sys -> events -> last_time > sys -> clock) {
+    return sys -> events -> last_time;
+  }
+  return sys -> clock;
+}
+
+// Bytes moved between the L1s and the L2, and between the L2 and DRAM:
+// every transfer is one sector, or one line when not sectored
+void memsys_traffic(Memsys *sys, uns64 *l2_bytes, uns64 *dram_bytes){
+  uns64 bytes = sys -> cfg.linesize / (sys -> cfg.sectors > 1 ? sys -> cfg.sectors : 1);
+  Cache *l2 = sys -> l2cache;
+  *l2_bytes = bytes * (l2 -> stat_read_access + l2 -> stat_write_access
+                       + l2 -> stat_skipped_read + l2 -> stat_skipped_write);
+  if (sys -> dramctrl) {
+    *dram_bytes = bytes * (sys -> dramctrl -> stat_read_access + sys -> dramctrl -> stat_write_access);
+  } else {
+    *dram_bytes = bytes * (sys -> dram -> stat_read_access + sys -> dram -> stat_write_access);
+  }
+}
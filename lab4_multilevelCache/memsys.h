@@ -0,0 +1,218 @@
+#ifndef MEMSYS_H
+#define MEMSYS_H
+
+#include "types.h"
+#include "cache.h"
+#include "dram.h"
+#include "dramctrl.h"
+#include "stackdist.h"
+#include "reuse.h"
+#include "prefetch.h"
+#include "mshr.h"
+#include "writebuf.h"
+#include "interval.h"
+#include "hier.h"
+#include "tlb.h"
+#include "trace.h"
+
+typedef struct Memsys   Memsys;
+typedef struct Memsys_Config Memsys_Config;
+
+//////////////////////////////////////////////////////////////////
+// What the L2 holds relative to the L1s (modes B/C)
+//////////////////////////////////////////////////////////////////
+
+typedef enum Inclusion_Policy_Enum {
+  INCLUSION_NINE,       // non-inclusive non-exclusive: no enforcement
+  INCLUSION_INCLUSIVE,  // L2 evictions back-invalidate the L1s
+  INCLUSION_EXCLUSIVE,  // L1 victims fill the L2, L2 hits move up
+  NUM_INCLUSION_POLICIES
+} Inclusion_Policy;
+
+//////////////////////////////////////////////////////////////////
+// What a DCACHE store miss does (modes B/C, blocking)
+//////////////////////////////////////////////////////////////////
+
+typedef enum Write_Miss_Policy_Enum {
+  WRITE_ALLOCATE,     // read the line from the L2, then write it
+  WRITE_NO_ALLOCATE,  // send the store to the L2, leave the DCACHE alone
+  WRITE_VALIDATE,     // install the line without reading it
+  NUM_WRITE_MISS_POLICIES
+} Write_Miss_Policy;
+
+//////////////////////////////////////////////////////////////////
+// Everything that configures one memory system. memsys_new() takes
+// it from the process-wide knobs set by sim.c; drivers that run
+// several systems side by side (sweep.c) fill in one per instance.
+//////////////////////////////////////////////////////////////////
+
+struct Memsys_Config {
+  MODE  sim_mode;
+  uns64 linesize;
+  uns64 repl_policy;
+
+  uns64 dcache_size;
+  uns64 dcache_assoc;
+  uns64 icache_size;
+  uns64 icache_assoc;
+  uns64 l2cache_size;
+  uns64 l2cache_assoc;
+
+  uns64 stackdist_max_sets;
+  uns64 stackdist_max_ways; // 0 = no stack-distance profiling
+  uns64 classify_misses;    // TRUE: three-C miss classification in every cache
+  uns64 reuse_profile;      // TRUE: reuse-distance histograms of every cache's stream
+
+  uns64 interval_accesses;  // counter deltas every this many accesses ...
+  uns64 interval_cycles;    // ... or cycles, 0 = never; see interval.h
+  char *interval_file;      // CSV the deltas go to
+
+  Prefetch_Config dcache_pf; // modes B/C only
+  Prefetch_Config icache_pf;
+  Prefetch_Config l2cache_pf;
+
+  uns64 dcache_mshrs;  // > 0 selects the non-blocking timing model (modes B/C)
+  uns64 l2cache_mshrs;
+
+  uns64 l2cache_inclusion; // Inclusion_Policy; exclusive is blocking only
+
+  uns64 dcache_victims;    // fully-associative victim cache entries, 0 = none
+
+  uns64 dcache_ports;      // DCACHE accesses per cycle, 0 = the lab model (modes B/C)
+  uns64 dcache_banks;      // word-interleaved DCACHE banks, 0 or 1 = unbanked
+
+  uns64 dcache_way_pred;   // Way_Pred_Policy (modes B/C)
+  uns64 icache_way_pred;
+
+  uns64 dcache_index;      // Index_Fn, see cache.h
+  uns64 icache_index;
+  uns64 l2cache_index;
+
+  uns64 dcache_write_through; // FALSE = write-back
+  uns64 dcache_write_miss;    // Write_Miss_Policy
+  uns64 dcache_write_buffer;  // coalescing write buffer entries, 0 = none
+
+  uns64 num_cores;         // > 1: run through multicore.h
+  uns64 l2cache_banks;     // shared L2 banks (multicore), 0 = unbanked
+  uns64 l2cache_sampling;  // simulate 1 in this many L2 sets, 0 or 1 = all (blocking)
+  uns64 sectors;           // sectors per line in every cache, 0 or 1 = none (blocking B/C)
+  uns64 warmup_accesses;   // accesses that only warm the caches before stats start
+  char *hierarchy_file;    // levels to build instead of DCACHE/ICACHE/L2, NULL = those (see hier.h)
+
+  DRAM_Config dram;    // dram.model selects the flat or banked DRAM timing
+  TLB_Config  tlb;     // tlb.page_size 0 = physical addresses, no TLBs (see tlb.h)
+};
+
+//////////////////////////////////////////////////////////////////
+// The memory system: L1 instruction and data caches, a shared L2,
+// and main memory behind it
+//////////////////////////////////////////////////////////////////
+
+struct Memsys {
+  Memsys_Config cfg;
+
+  Cache *dcache;  // For SIM_MODE_A, only the dcache is used
+  Cache *icache;
+  Cache *l2cache;
+  Cache *vcache;  // DCACHE victim cache (modes B/C), NULL if not configured
+  Write_Buffer *dcache_wbuf; // NULL if not configured
+  DRAM  *dram;
+  DRAM_Ctrl *dramctrl; // NULL unless cfg.dram.model is DRAM_MODEL_BANKED
+  Hierarchy *hier;     // NULL unless cfg.hierarchy_file is set; dcache, icache
+                       // and l2cache then alias its data and ifetch levels
+                       // and the one below the data level
+  TLB       *tlb;      // NULL unless cfg.tlb.page_size is set
+
+  // LRU stack-distance profiles of the streams seen by each cache,
+  // NULL unless STACKDIST_MAX_WAYS is set
+  Stack_Dist *sd_dcache;
+  Stack_Dist *sd_icache;
+  Stack_Dist *sd_l2cache;
+
+  // reuse-distance histograms of the same streams, NULL unless
+  // REUSE_PROFILE is set; L2 reads carry the type of the L1 access
+  // that missed, writebacks count as stores
+  Reuse_Dist *rd_dcache;
+  Reuse_Dist *rd_icache;
+  Reuse_Dist *rd_l2cache;
+
+  Interval_Log *interval; // NULL unless an interval period is set
+
+  // NULL when the cache has no prefetcher
+  Prefetcher *dcache_pf;
+  Prefetcher *icache_pf;
+  Prefetcher *l2cache_pf;
+
+  // non-blocking mode only: outstanding fills and their completions
+  MSHR_File   *dcache_mshr;
+  MSHR_File   *l2cache_mshr;
+  Event_Queue *events;
+
+  uns64 clock;     // blocking: sum of the delays so far, for prefetch timeliness
+                   // non-blocking: the cycle the next access issues
+  Addr  access_pc; // PC of the access being simulated, 0 if unknown
+  Access_Type access_type; // type of the access being simulated
+  Addr  access_addr;       // byte address of the access being simulated
+  uns   access_sector;     // sector of the line being accessed, 0 unless sectored
+  Flag  functional;        // accesses only update tags, see memsys_set_functional()
+  uns64 warmup_left;       // functional accesses left before stats start
+  Flag  l2_line_dirty; // exclusive: the line the last L2 read hit moved up was dirty
+  uns64 *l2cache_bank_free; // multicore: busy-until of each shared L2 bank, NULL = unbanked
+
+  // DCACHE ports and banks (cfg.dcache_ports): the cycle the next data
+  // access can issue at the earliest, the ports already taken in it,
+  // and the cycle and line each bank was last accessed at
+  uns64 dcache_port_cycle;
+  uns64 dcache_ports_used;
+  uns64 *dcache_bank_cycle;
+  Addr  *dcache_bank_line;
+
+  // L2 set sampling: accesses to unsampled sets are charged the recent
+  // mean delay past the L2 hit latency of sampled ones, kept per type
+  // of the L1 access that missed, and for writebacks at NUM_ACCESS_TYPES
+  int64 l2_sampled_delay[NUM_ACCESS_TYPES + 1]; // moving average, x L2_SAMPLE_SCALE
+
+  // stats
+  uns64 stat_ifetch_access;
+  uns64 stat_load_access;
+  uns64 stat_store_access;
+  uns64 stat_ifetch_delay;
+  uns64 stat_load_delay;
+  uns64 stat_store_delay;
+  uns64 stat_back_invals;      // L1 lines dropped by inclusive L2 evictions
+  uns64 stat_back_inval_dirty; // ... of which dirty, written to DRAM
+  uns64 stat_victim_fills;     // L1 victims installed by an exclusive L2
+  uns64 stat_l2_bank_wait;     // cycles spent waiting for busy L2 banks
+  uns64 stat_dcache_port_conflicts; // data accesses delayed for a free DCACHE port
+  uns64 stat_dcache_bank_conflicts; // ... for their bank, taken by another line
+  uns64 stat_dcache_port_wait;      // cycles of those delays
+};
+
+//////////////////////////////////////////////////////////////////
+// Used by sim.c
+//////////////////////////////////////////////////////////////////
+
+Memsys *memsys_new(void);
+void    memsys_config_default(Memsys_Config *cfg);
+Memsys *memsys_new_config(Memsys_Config *cfg);
+void    memsys_delete(Memsys *sys);
+void    memsys_print_stats(Memsys *sys);
+void    memsys_print_access_stats(Memsys *sys, char *header);
+uns64   memsys_access(Memsys *sys, Addr addr, Access_Type type);
+uns64   memsys_access_pc(Memsys *sys, Addr addr, Access_Type type, Addr pc);
+
+uns64   memsys_access_modeA(Memsys *sys, Addr lineaddr, Access_Type type);
+uns64   memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type);
+void    memsys_access_functional(Memsys *sys, Addr lineaddr, Access_Type type);
+void    memsys_set_functional(Memsys *sys, Flag functional);
+void    memsys_warm_trace(Memsys *sys, Trace *trace);
+void    memsys_clear_stats(Memsys *sys);
+uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback);
+uns64   memsys_access_hier(Memsys *sys, Addr lineaddr, Access_Type type);
+uns64   memsys_translate(Memsys *sys, Addr addr, Access_Type type);
+void    memsys_translate_functional(Memsys *sys, Addr addr, Access_Type type);
+uns64   memsys_access_nonblocking(Memsys *sys, Addr lineaddr, Access_Type type);
+uns64   memsys_cycles(Memsys *sys);
+void    memsys_traffic(Memsys *sys, uns64 *l2_bytes, uns64 *dram_bytes);
+
+#endif // MEMSYS_H
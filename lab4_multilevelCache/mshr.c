@@ -0,0 +1,191 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mshr.h"
+
+#define EVENT_QUEUE_INITIAL 1024
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+MSHR_File *mshr_new(uns64 num_entries){
+  MSHR_File *m = (MSHR_File *) calloc (1, sizeof (MSHR_File));
+  m->num_entries = num_entries;
+  m->entry = (MSHR_Entry *) calloc (num_entries, sizeof(MSHR_Entry));
+  return m;
+}
+
+void mshr_delete(MSHR_File *m){
+  free(m->entry);
+  free(m);
+}
+
+////////////////////////////////////////////////////////////////////
+// The entry holding an outstanding fill of lineaddr at cycle now
+////////////////////////////////////////////////////////////////////
+
+MSHR_Entry *mshr_find(MSHR_File *m, Addr lineaddr, uns64 now){
+  for(uns64 i = 0; i < m->num_entries; i++){
+    MSHR_Entry *e = &m->entry[i];
+    if(e->valid && e->lineaddr == lineaddr && e->ready > now){
+      return e;
+    }
+  }
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////
+// Earliest cycle, no sooner than now, at which an entry is free
+////////////////////////////////////////////////////////////////////
+
+uns64 mshr_next_free(MSHR_File *m, uns64 now){
+  uns64 next = ~0ULL;
+  for(uns64 i = 0; i < m->num_entries; i++){
+    MSHR_Entry *e = &m->entry[i];
+    if(!e->valid || e->ready <= now){
+      return now;
+    }
+    if(e->ready < next){
+      next = e->ready;
+    }
+  }
+  return next;
+}
+
+////////////////////////////////////////////////////////////////////
+// Take an entry that is free at cycle start for a fill completing at
+// ready, and account its busy interval (starts arrive in order)
+////////////////////////////////////////////////////////////////////
+
+MSHR_Entry *mshr_alloc(MSHR_File *m, Addr lineaddr, uns64 start, uns64 ready){
+  MSHR_Entry *e = NULL;
+  for(uns64 i = 0; i < m->num_entries; i++){
+    if(!m->entry[i].valid || m->entry[i].ready <= start){
+      e = &m->entry[i];
+      break;
+    }
+  }
+  assert(e != NULL);
+
+  e->valid = TRUE;
+  e->dirty = FALSE;
+  e->lineaddr = lineaddr;
+  e->ready = ready;
+
+  m->stat_primary++;
+  m->stat_busy_sum += ready - start;
+  if(start >= m->covered_until){
+    m->stat_busy_cycles += ready - start;
+    m->covered_until = ready;
+  } else if(ready > m->covered_until){
+    m->stat_busy_cycles += ready - m->covered_until;
+    m->covered_until = ready;
+  }
+  return e;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void mshr_clear_stats(MSHR_File *m){
+  m->stat_primary = 0;
+  m->stat_secondary = 0;
+  m->stat_full = 0;
+  m->stat_full_cycles = 0;
+  m->stat_busy_sum = 0;
+  m->stat_busy_cycles = 0;
+}
+
+void mshr_print_stats(MSHR_File *m, char *header){
+  double mlp = 0;
+
+  if(m->stat_busy_cycles){
+    mlp = (double)(m->stat_busy_sum)/(double)(m->stat_busy_cycles);
+  }
+
+  printf("\n%s_PRIMARY_MISS   \t\t : %10llu", header, m->stat_primary);
+  printf("\n%s_MERGED_MISS    \t\t : %10llu", header, m->stat_secondary);
+  printf("\n%s_FULL           \t\t : %10llu", header, m->stat_full);
+  printf("\n%s_FULL_CYCLES    \t\t : %10llu", header, m->stat_full_cycles);
+  printf("\n%s_BUSY_CYCLES    \t\t : %10llu", header, m->stat_busy_cycles);
+  printf("\n%s_MLP            \t\t : %10.3f", header, mlp);
+
+  printf("\n");
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Event queue
+////////////////////////////////////////////////////////////////////
+
+static Flag event_before(Event *a, Event *b){
+  return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+Event_Queue *event_queue_new(void){
+  Event_Queue *q = (Event_Queue *) calloc (1, sizeof (Event_Queue));
+  q->max_events = EVENT_QUEUE_INITIAL;
+  q->heap = (Event *) malloc (q->max_events * sizeof(Event));
+  return q;
+}
+
+void event_queue_delete(Event_Queue *q){
+  free(q->heap);
+  free(q);
+}
+
+void event_push(Event_Queue *q, uns64 time, Event_Type type, Addr lineaddr, MSHR_Entry *mshr){
+  if(q->num_events == q->max_events){
+    q->max_events *= 2;
+    q->heap = (Event *) realloc (q->heap, q->max_events * sizeof(Event));
+  }
+
+  Event ev;
+  ev.time = time;
+  ev.seq = q->next_seq++;
+  ev.type = type;
+  ev.lineaddr = lineaddr;
+  ev.mshr = mshr;
+  if(time > q->last_time){
+    q->last_time = time;
+  }
+
+  uns64 i = q->num_events++;
+  while(i > 0 && event_before(&ev, &q->heap[(i - 1) / 2])){
+    q->heap[i] = q->heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  q->heap[i] = ev;
+}
+
+////////////////////////////////////////////////////////////////////
+// Pop the earliest event if it is due by cycle now
+////////////////////////////////////////////////////////////////////
+
+Flag event_pop(Event_Queue *q, uns64 now, Event *ev){
+  if(q->num_events == 0 || q->heap[0].time > now){
+    return FALSE;
+  }
+
+  *ev = q->heap[0];
+  Event last = q->heap[--q->num_events];
+  uns64 i = 0;
+  for(;;){
+    uns64 child = 2 * i + 1;
+    if(child >= q->num_events){
+      break;
+    }
+    if(child + 1 < q->num_events && event_before(&q->heap[child + 1], &q->heap[child])){
+      child++;
+    }
+    if(!event_before(&q->heap[child], &last)){
+      break;
+    }
+    q->heap[i] = q->heap[child];
+    i = child;
+  }
+  q->heap[i] = last;
+  return TRUE;
+}
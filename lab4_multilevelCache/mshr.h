@@ -0,0 +1,80 @@
+#ifndef MSHR_H
+#define MSHR_H
+
+#include "types.h"
+
+typedef struct MSHR_Entry  MSHR_Entry;
+typedef struct MSHR_File   MSHR_File;
+typedef struct Event       Event;
+typedef struct Event_Queue Event_Queue;
+
+//////////////////////////////////////////////////////////////////
+// Miss status holding registers for a non-blocking cache. An entry
+// tracks one outstanding line fill and is busy until its data
+// arrives at cycle ready. A later miss to the same line merges into
+// the entry (a secondary miss) instead of going to the next level.
+//////////////////////////////////////////////////////////////////
+
+struct MSHR_Entry {
+  Flag  valid;
+  Flag  dirty;    // a store merged in, install the line dirty
+  Addr  lineaddr;
+  uns64 ready;    // cycle the fill completes
+};
+
+struct MSHR_File {
+  uns64       num_entries;
+  MSHR_Entry *entry;
+  uns64       covered_until; // end of the last busy interval, for MLP
+
+  //stats
+  uns64 stat_primary;      // misses that allocated an entry
+  uns64 stat_secondary;    // misses merged into an outstanding entry
+  uns64 stat_full;         // allocations that had to wait for a free entry
+  uns64 stat_full_cycles;  // cycles spent waiting
+  uns64 stat_busy_sum;     // sum over entries of busy cycles
+  uns64 stat_busy_cycles;  // cycles with at least one entry busy
+};
+
+MSHR_File  *mshr_new(uns64 num_entries);
+void        mshr_delete(MSHR_File *m);
+MSHR_Entry *mshr_find(MSHR_File *m, Addr lineaddr, uns64 now);
+uns64       mshr_next_free(MSHR_File *m, uns64 now);
+MSHR_Entry *mshr_alloc(MSHR_File *m, Addr lineaddr, uns64 start, uns64 ready);
+void        mshr_clear_stats(MSHR_File *m);
+void        mshr_print_stats(MSHR_File *m, char *header);
+
+
+//////////////////////////////////////////////////////////////////
+// Cycle-ordered queue of pending events (line fills), a binary heap.
+// Events at the same cycle pop in the order they were pushed.
+//////////////////////////////////////////////////////////////////
+
+typedef enum Event_Type_Enum {
+  EVENT_DCACHE_FILL,
+  EVENT_L2CACHE_FILL,
+  NUM_EVENT_TYPES
+} Event_Type;
+
+struct Event {
+  uns64      time;
+  uns64      seq;
+  Event_Type type;
+  Addr       lineaddr;
+  MSHR_Entry *mshr;      // entry the fill completes
+};
+
+struct Event_Queue {
+  Event *heap;
+  uns64  num_events;
+  uns64  max_events;
+  uns64  next_seq;
+  uns64  last_time;      // latest time ever scheduled
+};
+
+Event_Queue *event_queue_new(void);
+void         event_queue_delete(Event_Queue *q);
+void         event_push(Event_Queue *q, uns64 time, Event_Type type, Addr lineaddr, MSHR_Entry *mshr);
+Flag         event_pop(Event_Queue *q, uns64 now, Event *ev);
+
+#endif // MSHR_H
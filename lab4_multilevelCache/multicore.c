@@ -0,0 +1,299 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "multicore.h"
+
+#define UPGRADE_LATENCY  10  // a BusUpgr round trip, as long as an L2 hit
+
+#define INVAL_TRACK      4096  // per-core table of invalidated lines
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+Multicore *multicore_new(Memsys_Config *cfg){
+  if(cfg->num_cores == 0 || cfg->num_cores > TRACE_MAX_CORES){
+    printf("Number of cores must be between 1 and %d\n", TRACE_MAX_CORES);
+    exit(-1);
+  }
+  if(cfg->sim_mode == SIM_MODE_A || cfg->dcache_mshrs || cfg->dcache_victims || cfg->dcache_ports
+     || cfg->dcache_write_buffer || cfg->l2cache_inclusion != INCLUSION_NINE
+     || cfg->stackdist_max_ways || cfg->reuse_profile || cfg->sectors > 1 || cfg->warmup_accesses
+     || cfg->hierarchy_file || cfg->tlb.page_size || cfg->interval_accesses || cfg->interval_cycles
+     || cfg->dcache_pf.policy != PREFETCH_NONE
+     || cfg->icache_pf.policy != PREFETCH_NONE || cfg->l2cache_pf.policy != PREFETCH_NONE){
+    printf("Multicore runs need mode B/C with blocking, non-inclusive caches and no prefetchers,"
+           " DCACHE ports, victim cache, write buffer, sectored caches, warmup, hierarchy file, TLBs,"
+           " stack-distance/reuse profiling or interval statistics\n");
+    exit(-1);
+  }
+
+  Multicore *mc = (Multicore *) calloc (1, sizeof (Multicore));
+  mc->cfg = *cfg;
+  mc->num_cores = cfg->num_cores;
+  mc->core = (Memsys **) calloc (mc->num_cores, sizeof(Memsys *));
+  mc->inval = (Addr **) calloc (mc->num_cores, sizeof(Addr *));
+
+  if(cfg->l2cache_banks){
+    mc->l2cache_bank_free = (uns64 *) calloc (cfg->l2cache_banks, sizeof(uns64));
+  }
+
+  // core 0 owns the shared L2 and DRAM
+  mc->core[0] = memsys_new_config(cfg);
+  for(uns64 i = 0; i < mc->num_cores; i++){
+    if(i > 0){
+      Memsys *sys = (Memsys *) calloc (1, sizeof (Memsys));
+      sys->cfg = *cfg;
+      sys->dcache = cache_new_indexed(cfg->dcache_size, cfg->dcache_assoc, cfg->linesize, cfg->repl_policy,
+                                      cfg->dcache_index);
+      sys->icache = cache_new_indexed(cfg->icache_size, cfg->icache_assoc, cfg->linesize, cfg->repl_policy,
+                                      cfg->icache_index);
+      cache_set_way_pred(sys->dcache, cfg->dcache_way_pred);
+      cache_set_way_pred(sys->icache, cfg->icache_way_pred);
+      if(cfg->classify_misses){
+        cache_enable_threec(sys->dcache);
+        cache_enable_threec(sys->icache);
+      }
+      sys->l2cache = mc->core[0]->l2cache;
+      sys->dram = mc->core[0]->dram;
+      sys->dramctrl = mc->core[0]->dramctrl;
+      mc->core[i] = sys;
+    }
+    mc->core[i]->l2cache_bank_free = mc->l2cache_bank_free;
+
+    mc->inval[i] = (Addr *) malloc (INVAL_TRACK * sizeof(Addr));
+    memset(mc->inval[i], 0xff, INVAL_TRACK * sizeof(Addr));
+  }
+
+  return mc;
+}
+
+void multicore_delete(Multicore *mc){
+  for(uns64 i = 1; i < mc->num_cores; i++){
+    cache_delete(mc->core[i]->dcache);
+    cache_delete(mc->core[i]->icache);
+    free(mc->core[i]);
+  }
+  memsys_delete(mc->core[0]);
+
+  for(uns64 i = 0; i < mc->num_cores; i++){
+    free(mc->inval[i]);
+  }
+  free(mc->inval);
+  free(mc->l2cache_bank_free);
+  free(mc->core);
+  free(mc);
+}
+
+////////////////////////////////////////////////////////////////////
+// Bus side of a DCACHE access by core id, before the access itself.
+// Returns the extra delay it causes (upgrades only: a miss's bus
+// transaction is covered by its L2 access).
+////////////////////////////////////////////////////////////////////
+
+static uns64 multicore_snoop(Multicore *mc, uns64 id, Addr lineaddr, Flag is_write){
+  Memsys *sys = mc->core[id];
+  Flag present = (cache_probe(sys->dcache, lineaddr) == HIT);
+  Flag shared = FALSE;
+
+  Addr *lost = &mc->inval[id][lineaddr % INVAL_TRACK];
+  if(!present && *lost == lineaddr){
+    mc->stat_coherence_misses++;
+    *lost = INVALID_TAG;
+  }
+
+  for(uns64 j = 0; j < mc->num_cores; j++){
+    if(j == id){
+      continue;
+    }
+    Memsys *other = mc->core[j];
+    Cache_Line *line = cache_find_line(other->dcache, lineaddr);
+    if(line == NULL){
+      continue;
+    }
+    shared = TRUE;
+
+    if(line->dirty){
+      line->dirty = FALSE;
+      mc->stat_flushes++;
+      memsys_L2_access(other, lineaddr, 1);
+    }
+    if(is_write){
+      Flag dirty;
+      cache_invalidate(other->dcache, lineaddr, &dirty);
+      mc->inval[j][lineaddr % INVAL_TRACK] = lineaddr;
+      mc->stat_invalidations++;
+    }
+  }
+
+  if(is_write && present && shared){
+    mc->stat_upgrades++;
+    return UPGRADE_LATENCY;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+uns64 multicore_access(Multicore *mc, uns64 core, Addr addr, Access_Type type, Addr pc){
+  Memsys *sys = mc->core[core];
+  uns64 delay = 0;
+
+  if(type != ACCESS_TYPE_IFETCH){
+    delay = multicore_snoop(mc, core, addr / mc->cfg.linesize, type == ACCESS_TYPE_STORE);
+    sys->clock += delay;
+    if(type == ACCESS_TYPE_STORE){
+      sys->stat_store_delay += delay;
+    }
+  }
+
+  return delay + memsys_access_pc(sys, addr, type, pc);
+}
+
+// Sum the per-core stats into mc->total, the same way shard.c merges shards
+static void multicore_total(Multicore *mc){
+  Memsys *total = &mc->total;
+  *total = *mc->core[0];
+  total->dcache = &mc->total_dcache;
+  total->icache = &mc->total_icache;
+  mc->total_dcache = *mc->core[0]->dcache;
+  mc->total_icache = *mc->core[0]->icache;
+  cache_clear_stats(&mc->total_dcache);
+  cache_clear_stats(&mc->total_icache);
+  total->clock = 0;
+  total->stat_ifetch_access = 0;
+  total->stat_load_access = 0;
+  total->stat_store_access = 0;
+  total->stat_ifetch_delay = 0;
+  total->stat_load_delay = 0;
+  total->stat_store_delay = 0;
+  total->stat_l2_bank_wait = 0;
+
+  for(uns64 i = 0; i < mc->num_cores; i++){
+    Memsys *part = mc->core[i];
+    cache_add_stats(&mc->total_dcache, part->dcache);
+    cache_add_stats(&mc->total_icache, part->icache);
+    if(part->clock > total->clock){
+      total->clock = part->clock;
+    }
+    total->stat_ifetch_access += part->stat_ifetch_access;
+    total->stat_load_access += part->stat_load_access;
+    total->stat_store_access += part->stat_store_access;
+    total->stat_ifetch_delay += part->stat_ifetch_delay;
+    total->stat_load_delay += part->stat_load_delay;
+    total->stat_store_delay += part->stat_store_delay;
+    total->stat_l2_bank_wait += part->stat_l2_bank_wait;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Each core replays its own records in trace order, and the core
+// with the earliest clock always goes next, so the cores move through
+// time together and their L2 bank and coherence traffic interleaves
+// as it would when running in parallel.
+////////////////////////////////////////////////////////////////////
+
+void multicore_run(Multicore *mc, Trace *trace){
+  uns64 n = mc->num_cores;
+  uns64 *first = (uns64 *) calloc (n + 1, sizeof(uns64));
+  uns64 *next = (uns64 *) calloc (n, sizeof(uns64));
+  uns64 *order = (uns64 *) malloc (trace->num_recs * sizeof(uns64));
+
+  // bucket the record numbers by core, keeping trace order
+  for(uns64 i = 0; i < trace->num_recs; i++){
+    uns64 core = trace->cores ? trace->cores[i] : 0;
+    if(core >= n){
+      printf("Trace record %llu is for core %llu, but only %llu cores are simulated\n",
+             i, core, n);
+      exit(-1);
+    }
+    first[core + 1]++;
+  }
+  for(uns64 c = 0; c < n; c++){
+    first[c + 1] += first[c];
+    next[c] = first[c];
+  }
+  for(uns64 i = 0; i < trace->num_recs; i++){
+    uns64 core = trace->cores ? trace->cores[i] : 0;
+    order[next[core]++] = i;
+  }
+  for(uns64 c = 0; c < n; c++){
+    next[c] = first[c];
+  }
+
+  for(;;){
+    uns64 core = n;
+    for(uns64 c = 0; c < n; c++){
+      if(next[c] < first[c + 1] && (core == n || mc->core[c]->clock < mc->core[core]->clock)){
+        core = c;
+      }
+    }
+    if(core == n){
+      break;
+    }
+    uns64 i = order[next[core]++];
+    Addr addr = trace_rec_addr(trace->recs[i]);
+    Access_Type type = trace_rec_type(trace->recs[i]);
+    Addr pc = trace->pcs ? trace->pcs[i] : (type == ACCESS_TYPE_IFETCH) ? addr : 0;
+    multicore_access(mc, core, addr, type, pc);
+  }
+
+  free(order);
+  free(next);
+  free(first);
+  multicore_total(mc);
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void multicore_print_stats(Multicore *mc){
+  char header[256];
+
+  for(uns64 i = 0; i < mc->num_cores; i++){
+    Memsys *sys = mc->core[i];
+    sprintf(header, "CORE%llu", i);
+    memsys_print_access_stats(sys, header);
+    if(mc->l2cache_bank_free){
+      printf("\n%s_L2BANK_WAIT   \t\t : %10llu", header, sys->stat_l2_bank_wait);
+      printf("\n");
+    }
+    sprintf(header, "CORE%llu_DCACHE", i);
+    cache_print_stats(sys->dcache, header);
+    sprintf(header, "CORE%llu_ICACHE", i);
+    cache_print_stats(sys->icache, header);
+    if(mc->cfg.classify_misses){
+      sprintf(header, "CORE%llu_DCACHE", i);
+      cache_print_threec_stats(sys->dcache, header);
+      sprintf(header, "CORE%llu_ICACHE", i);
+      cache_print_threec_stats(sys->icache, header);
+    }
+  }
+
+  Memsys *shared = mc->core[0];
+  printf("\n");
+  cache_print_stats(shared->l2cache, "L2CACHE");
+  if(mc->cfg.classify_misses){
+    cache_print_threec_stats(shared->l2cache, "L2CACHE");
+  }
+  if(shared->l2cache->set_sampled){
+    cache_print_sampling_stats(shared->l2cache, "L2CACHE");
+  }
+  if(shared->dramctrl){
+    dramctrl_print_stats(shared->dramctrl);
+  } else {
+    dram_print_stats(shared->dram);
+  }
+
+  sprintf(header, "COHERENCE");
+  printf("\n");
+  printf("\n%s_MISSES        \t\t : %10llu", header, mc->stat_coherence_misses);
+  printf("\n%s_INVALIDATIONS \t\t : %10llu", header, mc->stat_invalidations);
+  printf("\n%s_UPGRADES      \t\t : %10llu", header, mc->stat_upgrades);
+  printf("\n%s_FLUSHES       \t\t : %10llu", header, mc->stat_flushes);
+  printf("\n");
+  printf("\nMULTICORE_CYCLES     \t\t : %10llu", memsys_cycles(&mc->total));
+  printf("\n");
+}
@@ -0,0 +1,67 @@
+#ifndef MULTICORE_H
+#define MULTICORE_H
+
+#include "types.h"
+#include "memsys.h"
+#include "trace.h"
+
+typedef struct Multicore Multicore;
+
+//////////////////////////////////////////////////////////////////
+// N cores, each with a private DCACHE and ICACHE, in front of one
+// shared L2 and DRAM (modes B/C, blocking timing).
+//
+// Every core is a Memsys of its own whose l2cache, dram and dramctrl
+// point at core 0's, so the normal L1/L2 code runs unchanged and
+// each core keeps its own access stats and clock. With
+// cfg.l2cache_banks set, the shared L2 is split into that many banks
+// by line address; a core whose L2 access finds its bank busy waits
+// for it (see memsys_L2_access).
+//
+// The DCACHEs are kept coherent with MESI over a snooping bus. The
+// state of a line is read from the caches themselves: M is dirty, S
+// is present in another DCACHE too, E is the only clean copy.
+//  - load miss:  a core holding the line in M flushes it to the L2
+//                and keeps it in S; the requester gets S (or E if no
+//                other core has the line)
+//  - store miss: (BusRdX) every other copy is invalidated, an M
+//                copy is flushed to the L2 first
+//  - store hit:  in S, an upgrade (BusUpgr) invalidates the other
+//                copies and costs UPGRADE_LATENCY; in E or M it is
+//                silent
+// A coherence miss is a DCACHE miss to a line this core lost to an
+// invalidation. ICACHEs hold read-only code and are not snooped.
+//
+// multicore_run() keeps every core's records in trace order but
+// always steps the core with the earliest clock, so cores advance
+// together in time.
+//////////////////////////////////////////////////////////////////
+
+struct Multicore {
+  Memsys_Config cfg;
+  uns64         num_cores;
+  Memsys      **core;
+
+  uns64        *l2cache_bank_free; // NULL unless cfg.l2cache_banks
+  Addr        **inval;             // [core] lines lost to invalidations
+
+  // sums over the cores after multicore_run(), in Memsys form so
+  // drivers can report them like a single core; clock is the slowest core's
+  Memsys        total;
+  Cache         total_dcache;
+  Cache         total_icache;
+
+  //stats
+  uns64 stat_coherence_misses;
+  uns64 stat_invalidations;  // remote DCACHE copies invalidated
+  uns64 stat_upgrades;       // store hits in S
+  uns64 stat_flushes;        // M copies flushed to the L2 for another core
+};
+
+Multicore *multicore_new(Memsys_Config *cfg);
+void       multicore_delete(Multicore *mc);
+uns64      multicore_access(Multicore *mc, uns64 core, Addr addr, Access_Type type, Addr pc);
+void       multicore_run(Multicore *mc, Trace *trace);
+void       multicore_print_stats(Multicore *mc);
+
+#endif // MULTICORE_H
@@ -0,0 +1,206 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefetch.h"
+
+#define STRIDE_CONF_MAX     3
+#define STRIDE_CONF_ISSUE   2
+#define STREAM_WINDOW       16  // lines a miss may be from a stream's last miss
+#define STREAM_CONF_ISSUE   2
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+Prefetcher *prefetcher_new(Prefetch_Config *cfg){
+  if(cfg->policy >= NUM_PREFETCH_POLICIES){
+    printf("Unknown prefetch policy %llu\n", cfg->policy);
+    exit(-1);
+  }
+  if(cfg->degree == 0 || cfg->degree > PREFETCH_MAX_DEGREE){
+    printf("Prefetch degree must be between 1 and %d\n", PREFETCH_MAX_DEGREE);
+    exit(-1);
+  }
+
+  Prefetcher *pf = (Prefetcher *) calloc (1, sizeof (Prefetcher));
+  pf->cfg = *cfg;
+  return pf;
+}
+
+void prefetcher_delete(Prefetcher *pf){
+  free(pf);
+}
+
+////////////////////////////////////////////////////////////////////
+// Per-PC stride: confident once the same line stride repeats.
+// Accesses within the same line as the last one are ignored.
+////////////////////////////////////////////////////////////////////
+
+static uns stride_observe(Prefetcher *pf, Addr lineaddr, Addr pc, Addr *candidates){
+  Stride_Entry *e = &pf->stride[(pc ^ (pc >> 8)) % PREFETCH_STRIDE_ENTRIES];
+
+  if(e->pc != pc || e->last_lineaddr == 0){
+    e->pc = pc;
+    e->last_lineaddr = lineaddr;
+    e->stride = 0;
+    e->confidence = 0;
+    return 0;
+  }
+
+  int64 delta = (int64) (lineaddr - e->last_lineaddr);
+  if(delta == 0){
+    return 0;
+  }
+  if(delta == e->stride){
+    if(e->confidence < STRIDE_CONF_MAX){
+      e->confidence++;
+    }
+  } else if(e->confidence > 0){
+    e->confidence--;
+  } else {
+    e->stride = delta;
+  }
+  e->last_lineaddr = lineaddr;
+
+  if(e->confidence < STRIDE_CONF_ISSUE){
+    return 0;
+  }
+  for(uns i = 0; i < pf->cfg.degree; i++){
+    candidates[i] = lineaddr + e->stride * (int64) (pf->cfg.distance + i);
+  }
+  return pf->cfg.degree;
+}
+
+////////////////////////////////////////////////////////////////////
+// Streams: a miss close to a tracked stream's last miss extends it
+// (and sets its direction); otherwise it replaces the LRU tracker
+////////////////////////////////////////////////////////////////////
+
+static uns stream_observe(Prefetcher *pf, Addr lineaddr, Addr *candidates){
+  Stream_Entry *hit = NULL;
+  Stream_Entry *lru = &pf->stream[0];
+
+  for(uns i = 0; i < PREFETCH_STREAMS; i++){
+    Stream_Entry *e = &pf->stream[i];
+    if(e->valid){
+      int64 delta = (int64) (lineaddr - e->last_lineaddr);
+      if(delta != 0 && delta >= -STREAM_WINDOW && delta <= STREAM_WINDOW){
+        hit = e;
+        break;
+      }
+    }
+    if(!e->valid || (lru->valid && e->last_use < lru->last_use)){
+      lru = e;
+    }
+  }
+
+  if(hit == NULL){
+    lru->valid = TRUE;
+    lru->last_lineaddr = lineaddr;
+    lru->dir = 0;
+    lru->confidence = 0;
+    lru->last_use = pf->num_triggers;
+    return 0;
+  }
+
+  int64 dir = ((int64) (lineaddr - hit->last_lineaddr) > 0) ? 1 : -1;
+  if(dir == hit->dir){
+    hit->confidence++;
+  } else {
+    hit->dir = dir;
+    hit->confidence = 1;
+  }
+  hit->last_lineaddr = lineaddr;
+  hit->last_use = pf->num_triggers;
+
+  if(hit->confidence < STREAM_CONF_ISSUE){
+    return 0;
+  }
+  for(uns i = 0; i < pf->cfg.degree; i++){
+    candidates[i] = lineaddr + dir * (int64) (pf->cfg.distance + i);
+  }
+  return pf->cfg.degree;
+}
+
+////////////////////////////////////////////////////////////////////
+// Called for every demand access to the cache. trigger is TRUE on a
+// miss or on the first demand hit to a prefetched line. Fills up to
+// cfg.degree line addresses into candidates and returns how many.
+////////////////////////////////////////////////////////////////////
+
+uns prefetcher_observe(Prefetcher *pf, Addr lineaddr, Addr pc, Flag trigger, Addr *candidates){
+  if(trigger){
+    pf->num_triggers++;
+  }
+
+  switch(pf->cfg.policy){
+  case PREFETCH_NEXTLINE:
+    if(!trigger){
+      return 0;
+    }
+    for(uns i = 0; i < pf->cfg.degree; i++){
+      candidates[i] = lineaddr + pf->cfg.distance + i;
+    }
+    return pf->cfg.degree;
+
+  case PREFETCH_STRIDE:
+    return stride_observe(pf, lineaddr, pc, candidates);
+
+  case PREFETCH_STREAM:
+    return trigger ? stream_observe(pf, lineaddr, candidates) : 0;
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void prefetcher_issued(Prefetcher *pf, Addr lineaddr, uns64 ready){
+  Inflight_Entry *e = &pf->inflight[lineaddr % PREFETCH_INFLIGHT];
+  e->lineaddr = lineaddr;
+  e->ready = ready;
+  pf->stat_issued++;
+}
+
+////////////////////////////////////////////////////////////////////
+// A demand access hit a prefetched line at time now. Returns the
+// cycles it still has to wait for the fill (0 if it was on time).
+////////////////////////////////////////////////////////////////////
+
+uns64 prefetcher_useful(Prefetcher *pf, Addr lineaddr, uns64 now){
+  Inflight_Entry *e = &pf->inflight[lineaddr % PREFETCH_INFLIGHT];
+  pf->stat_useful++;
+  if(e->lineaddr == lineaddr && e->ready > now){
+    pf->stat_late++;
+    return e->ready - now;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void prefetcher_clear_stats(Prefetcher *pf){
+  pf->stat_issued = 0;
+  pf->stat_useful = 0;
+  pf->stat_late = 0;
+  pf->stat_polluting = 0;
+}
+
+void prefetcher_print_stats(Prefetcher *pf, char *header){
+  double accuracy = 0;
+
+  if(pf->stat_issued){
+    accuracy = (double)(pf->stat_useful)/(double)(pf->stat_issued);
+  }
+
+  printf("\n%s_ISSUED         \t\t : %10llu", header, pf->stat_issued);
+  printf("\n%s_USEFUL         \t\t : %10llu", header, pf->stat_useful);
+  printf("\n%s_LATE           \t\t : %10llu", header, pf->stat_late);
+  printf("\n%s_POLLUTING      \t\t : %10llu", header, pf->stat_polluting);
+  printf("\n%s_ACCURACYPERC   \t\t : %10.3f", header, 100*accuracy);
+
+  printf("\n");
+}
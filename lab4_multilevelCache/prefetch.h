@@ -0,0 +1,80 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "types.h"
+
+typedef struct Prefetcher Prefetcher;
+typedef struct Prefetch_Config Prefetch_Config;
+
+//////////////////////////////////////////////////////////////////
+// Hardware prefetchers. One Prefetcher sits beside a cache, sees
+// that cache's demand stream and proposes line addresses to fetch.
+// memsys.c filters out lines already present, fills the rest into
+// the cache off the critical path, and feeds back the stats.
+//////////////////////////////////////////////////////////////////
+
+typedef enum Prefetch_Policy_Enum {
+  PREFETCH_NONE,
+  PREFETCH_NEXTLINE, // tagged next-line: on a miss or a first prefetch hit
+  PREFETCH_STRIDE,   // per-PC stride table (PC 0 when the trace has none)
+  PREFETCH_STREAM,   // tracks several ascending/descending miss streams
+  NUM_PREFETCH_POLICIES
+} Prefetch_Policy;
+
+struct Prefetch_Config {
+  uns64 policy;   // Prefetch_Policy
+  uns64 degree;   // lines proposed per trigger
+  uns64 distance; // lines ahead of the access for the first of them
+};
+
+#define PREFETCH_MAX_DEGREE   16
+#define PREFETCH_STRIDE_ENTRIES 256
+#define PREFETCH_STREAMS      16
+#define PREFETCH_INFLIGHT     256
+
+typedef struct Stride_Entry {
+  Addr  pc;
+  Addr  last_lineaddr;
+  int64 stride;
+  uns   confidence;
+} Stride_Entry;
+
+typedef struct Stream_Entry {
+  Flag  valid;
+  Addr  last_lineaddr;
+  int64 dir;
+  uns   confidence;
+  uns64 last_use;
+} Stream_Entry;
+
+// Recently issued prefetches and when their data arrives, to spot
+// demand hits on prefetched lines that are still in flight
+typedef struct Inflight_Entry {
+  Addr  lineaddr;
+  uns64 ready;
+} Inflight_Entry;
+
+struct Prefetcher {
+  Prefetch_Config cfg;
+
+  Stride_Entry   stride[PREFETCH_STRIDE_ENTRIES];
+  Stream_Entry   stream[PREFETCH_STREAMS];
+  Inflight_Entry inflight[PREFETCH_INFLIGHT];
+  uns64          num_triggers;
+
+  //stats
+  uns64 stat_issued;    // prefetch fills into the cache
+  uns64 stat_useful;    // prefetched lines later hit by a demand access
+  uns64 stat_late;      // ... of which the fill had not completed yet
+  uns64 stat_polluting; // prefetched lines evicted without being used
+};
+
+Prefetcher *prefetcher_new(Prefetch_Config *cfg);
+void        prefetcher_delete(Prefetcher *pf);
+uns         prefetcher_observe(Prefetcher *pf, Addr lineaddr, Addr pc, Flag trigger, Addr *candidates);
+void        prefetcher_issued(Prefetcher *pf, Addr lineaddr, uns64 ready);
+uns64       prefetcher_useful(Prefetcher *pf, Addr lineaddr, uns64 now);
+void        prefetcher_clear_stats(Prefetcher *pf);
+void        prefetcher_print_stats(Prefetcher *pf, char *header);
+
+#endif // PREFETCH_H
@@ -0,0 +1,330 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "repl.h"
+
+// Bitmask policies (PLRU, NRU, RRIP) keep one bit per way in an uns32
+#define REPL_MAX_MASK_WAYS 32
+
+// LRU keeps one uns8 rank per way
+#define REPL_MAX_RANK_WAYS 256
+
+#define RRIP_MAX_RRPV     3
+#define RRIP_LONG_RRPV    2   // SRRIP insertion
+#define BRRIP_LONG_EVERY  32  // BRRIP inserts at LONG once per this many fills
+
+#define DRRIP_PSEL_BITS   10
+#define DRRIP_PSEL_MAX    ((1 << DRRIP_PSEL_BITS) - 1)
+#define DRRIP_LEADERS     32  // leader sets per policy, fewer below 128 sets
+
+static uns32 way_mask(uns64 num_ways){
+  return (num_ways >= 32) ? 0xffffffffu : ((1u << num_ways) - 1);
+}
+
+static void check_mask_ways(char *name, uns64 num_ways){
+  if(num_ways > REPL_MAX_MASK_WAYS){
+    printf("%s replacement supports at most %d ways\n", name, REPL_MAX_MASK_WAYS);
+    exit(-1);
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+// LRU: a recency rank per way, 0 is MRU and num_ways-1 is LRU.
+// Ranks start as the way number so empty ways fill in order.
+// Hash-indexed fully associative caches keep a list instead (cache.c).
+////////////////////////////////////////////////////////////////////
+
+static void *lru_init(uns64 num_sets, uns64 num_ways){
+  if(num_ways > REPL_MAX_RANK_WAYS){
+    printf("LRU replacement supports at most %d ways per set\n", REPL_MAX_RANK_WAYS);
+    exit(-1);
+  }
+  uns8 *rank = (uns8 *) malloc(num_sets * num_ways);
+  for(uns64 s = 0; s < num_sets; s++){
+    for(uns64 w = 0; w < num_ways; w++){
+      rank[s * num_ways + w] = w;
+    }
+  }
+  return rank;
+}
+
+static void lru_touch(Cache *c, uns64 set, uns way){
+  uns8 *rank = (uns8 *) c->repl_state + set * c->num_ways;
+  uns8 old = rank[way];
+  for(uns64 w = 0; w < c->num_ways; w++){
+    if(rank[w] < old){
+      rank[w]++;
+    }
+  }
+  rank[way] = 0;
+}
+
+static uns lru_victim(Cache *c, uns64 set){
+  uns8 *rank = (uns8 *) c->repl_state + set * c->num_ways;
+  uns w = 0;
+  while(rank[w] != c->num_ways - 1){
+    w++;
+  }
+  return w;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// RAND: a private xorshift64 generator per set rather than rand(),
+// so runs are repeatable, and a set draws the same victims whether
+// the cache is simulated whole or split across threads
+////////////////////////////////////////////////////////////////////
+
+#define RAND_SEED 0x9e3779b97f4a7c15ULL
+
+static void *rand_init(uns64 num_sets, uns64 num_ways){
+  uns64 *seed = (uns64 *) malloc(num_sets * sizeof(uns64));
+  for(uns64 s = 0; s < num_sets; s++){
+    // splitmix64 of the set number, so neighbouring sets are unrelated
+    uns64 z = RAND_SEED * (s + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+    seed[s] = z ? z : RAND_SEED;
+  }
+  return seed;
+}
+
+static void rand_touch(Cache *c, uns64 set, uns way){
+}
+
+static uns rand_victim(Cache *c, uns64 set){
+  uns64 *seed = (uns64 *) c->repl_state + set;
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed % c->num_ways;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// PLRU: binary tree over the ways, node n at bit n (root is 1).
+// A node bit of 1 means the pseudo-LRU side is the right subtree.
+// Both update and victim walk one root-to-leaf path: O(log ways).
+////////////////////////////////////////////////////////////////////
+
+static void *plru_init(uns64 num_sets, uns64 num_ways){
+  check_mask_ways("PLRU", num_ways);
+  if(num_ways & (num_ways - 1)){
+    printf("PLRU replacement needs a power-of-two number of ways\n");
+    exit(-1);
+  }
+  return calloc(num_sets, sizeof(uns32));
+}
+
+static void plru_touch(Cache *c, uns64 set, uns way){
+  uns32 *tree = (uns32 *) c->repl_state + set;
+  uns node = 1;
+  for(uns half = c->num_ways >> 1; half; half >>= 1){
+    uns right = (way & half) ? 1 : 0;
+    if(right){
+      *tree &= ~(1u << node);   // point away: LRU side is the left
+    } else {
+      *tree |= (1u << node);
+    }
+    node = 2 * node + right;
+  }
+}
+
+static uns plru_victim(Cache *c, uns64 set){
+  uns32 tree = ((uns32 *) c->repl_state)[set];
+  uns node = 1;
+  while(node < c->num_ways){
+    node = 2 * node + ((tree >> node) & 1);
+  }
+  return node - c->num_ways;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// NRU: one referenced bit per way, cleared for the other ways
+// once every way has been referenced
+////////////////////////////////////////////////////////////////////
+
+static void *nru_init(uns64 num_sets, uns64 num_ways){
+  check_mask_ways("NRU", num_ways);
+  return calloc(num_sets, sizeof(uns32));
+}
+
+static void nru_touch(Cache *c, uns64 set, uns way){
+  uns32 *ref = (uns32 *) c->repl_state + set;
+  *ref |= (1u << way);
+  if(*ref == way_mask(c->num_ways)){
+    *ref = (1u << way);
+  }
+}
+
+static uns nru_victim(Cache *c, uns64 set){
+  uns32 ref = ((uns32 *) c->repl_state)[set];
+  return __builtin_ctz(~ref & way_mask(c->num_ways));
+}
+
+
+////////////////////////////////////////////////////////////////////
+// RRIP: the 2-bit RRPV of each way is split over two bit planes,
+// so finding a distant (RRPV 3) way and aging the whole set are
+// each a couple of word operations instead of a scan over the ways
+////////////////////////////////////////////////////////////////////
+
+typedef struct Rrip_Set {
+  uns32 hi;
+  uns32 lo;
+} Rrip_Set;
+
+typedef struct Rrip_State {
+  uns64 psel;        // DRRIP: high means BRRIP is winning
+  uns64 fill_count;  // BRRIP: bimodal throttle
+  uns64 constituency; // DRRIP: sets per constituency, one leader of each policy in each
+  Rrip_Set sets[];
+} Rrip_State;
+
+static void rrip_set_rrpv(Rrip_Set *s, uns way, uns rrpv){
+  uns32 bit = 1u << way;
+  s->hi = (rrpv & 2) ? (s->hi | bit) : (s->hi & ~bit);
+  s->lo = (rrpv & 1) ? (s->lo | bit) : (s->lo & ~bit);
+}
+
+static void *rrip_init(uns64 num_sets, uns64 num_ways){
+  check_mask_ways("RRIP", num_ways);
+  Rrip_State *st = (Rrip_State *) calloc(1, sizeof(Rrip_State) + num_sets * sizeof(Rrip_Set));
+  st->psel = (DRRIP_PSEL_MAX + 1) / 2;
+  st->constituency = num_sets / DRRIP_LEADERS;
+  if(st->constituency < 4){
+    st->constituency = 4;
+  }
+  for(uns64 s = 0; s < num_sets; s++){
+    st->sets[s].hi = st->sets[s].lo = way_mask(num_ways);
+  }
+  return st;
+}
+
+static void rrip_hit(Cache *c, uns64 set, uns way){
+  Rrip_State *st = (Rrip_State *) c->repl_state;
+  rrip_set_rrpv(&st->sets[set], way, 0);
+}
+
+static uns rrip_victim(Cache *c, uns64 set){
+  Rrip_State *st = (Rrip_State *) c->repl_state;
+  Rrip_Set *s = &st->sets[set];
+  uns32 mask = way_mask(c->num_ways);
+  // no way at RRPV 3 means every way is below it, so +1 cannot overflow
+  while(!(s->hi & s->lo & mask)){
+    uns32 carry = s->lo;
+    s->lo = ~s->lo & mask;
+    s->hi = (s->hi ^ carry) & mask;
+  }
+  return __builtin_ctz(s->hi & s->lo & mask);
+}
+
+static uns brrip_rrpv(Rrip_State *st){
+  st->fill_count++;
+  if(st->fill_count % BRRIP_LONG_EVERY == 0){
+    return RRIP_LONG_RRPV;
+  }
+  return RRIP_MAX_RRPV;
+}
+
+static void srrip_insert(Cache *c, uns64 set, uns way){
+  Rrip_State *st = (Rrip_State *) c->repl_state;
+  rrip_set_rrpv(&st->sets[set], way, RRIP_LONG_RRPV);
+}
+
+static void brrip_insert(Cache *c, uns64 set, uns way){
+  Rrip_State *st = (Rrip_State *) c->repl_state;
+  rrip_set_rrpv(&st->sets[set], way, brrip_rrpv(st));
+}
+
+// Leader sets: the sets are cut into constituencies of
+// num_sets/DRRIP_LEADERS, and constituency k leads with its set k
+// (SRRIP) and the set half a constituency further on (BRRIP), so the
+// leaders spread over the whole cache. Constituencies are at least 4
+// sets, so below 4*DRRIP_LEADERS sets each policy has num_sets/4
+// leaders and half the sets still follow. Under 4 sets there is no
+// BRRIP leader to duel with; use SRRIP or BRRIP there.
+static void drrip_insert(Cache *c, uns64 set, uns way){
+  Rrip_State *st = (Rrip_State *) c->repl_state;
+  uns64 size = st->constituency;
+  uns64 offset = set % size;
+  uns64 leader = (set / size) % size;
+  uns rrpv;
+
+  // inserts only happen on misses, so this is where leaders vote
+  if(offset == leader){
+    if(st->psel < DRRIP_PSEL_MAX){
+      st->psel++;
+    }
+    rrpv = RRIP_LONG_RRPV;
+  } else if(offset == (leader + size / 2) % size){
+    if(st->psel > 0){
+      st->psel--;
+    }
+    rrpv = brrip_rrpv(st);
+  } else if(st->psel > DRRIP_PSEL_MAX / 2){
+    rrpv = brrip_rrpv(st);
+  } else {
+    rrpv = RRIP_LONG_RRPV;
+  }
+  rrip_set_rrpv(&st->sets[set], way, rrpv);
+}
+
+
+////////////////////////////////////////////////////////////////////
+// LFU: saturating use count per way, ties go to the lowest way
+////////////////////////////////////////////////////////////////////
+
+static void *lfu_init(uns64 num_sets, uns64 num_ways){
+  return calloc(num_sets * num_ways, sizeof(uns8));
+}
+
+static void lfu_hit(Cache *c, uns64 set, uns way){
+  uns8 *count = (uns8 *) c->repl_state + set * c->num_ways;
+  if(count[way] < 255){
+    count[way]++;
+  }
+}
+
+static uns lfu_victim(Cache *c, uns64 set){
+  uns8 *count = (uns8 *) c->repl_state + set * c->num_ways;
+  uns victim = 0;
+  for(uns w = 1; w < c->num_ways; w++){
+    if(count[w] < count[victim]){
+      victim = w;
+    }
+  }
+  return victim;
+}
+
+static void lfu_insert(Cache *c, uns64 set, uns way){
+  uns8 *count = (uns8 *) c->repl_state + set * c->num_ways;
+  count[way] = 1;
+}
+
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+static const Repl_Policy repl_policies[NUM_REPL_POLICIES] = {
+  [REPL_LRU]   = { "LRU",   TRUE,  lru_init,   lru_touch,  lru_victim,  lru_touch    },
+  [REPL_RAND]  = { "RAND",  TRUE,  rand_init,  rand_touch, rand_victim, rand_touch   },
+  [REPL_PLRU]  = { "PLRU",  TRUE,  plru_init,  plru_touch, plru_victim, plru_touch   },
+  [REPL_NRU]   = { "NRU",   TRUE,  nru_init,   nru_touch,  nru_victim,  nru_touch    },
+  [REPL_SRRIP] = { "SRRIP", TRUE,  rrip_init,  rrip_hit,   rrip_victim, srrip_insert },
+  [REPL_BRRIP] = { "BRRIP", FALSE, rrip_init,  rrip_hit,   rrip_victim, brrip_insert },
+  [REPL_DRRIP] = { "DRRIP", FALSE, rrip_init,  rrip_hit,   rrip_victim, drrip_insert },
+  [REPL_LFU]   = { "LFU",   TRUE,  lfu_init,   lfu_hit,    lfu_victim,  lfu_insert   },
+};
+
+const Repl_Policy *repl_policy_get(uns64 repl_policy){
+  if(repl_policy >= NUM_REPL_POLICIES){
+    printf("Unknown replacement policy %llu\n", repl_policy);
+    exit(-1);
+  }
+  return &repl_policies[repl_policy];
+}
@@ -0,0 +1,44 @@
+#ifndef REPL_H
+#define REPL_H
+
+#include "types.h"
+#include "cache.h"
+
+//////////////////////////////////////////////////////////////////
+// Replacement policies, selected by the repl_policy argument of
+// cache_new(). The numbering keeps 0 (LRU) and 1 (RAND) as before.
+//////////////////////////////////////////////////////////////////
+
+typedef enum Repl_Policy_Enum {
+  REPL_LRU,     // true LRU, per-way recency rank
+  REPL_RAND,    // random victim
+  REPL_PLRU,    // tree pseudo-LRU, ways-1 bits per set
+  REPL_NRU,     // not-recently-used, 1 bit per way
+  REPL_SRRIP,   // static RRIP, 2-bit RRPV per way
+  REPL_BRRIP,   // bimodal RRIP
+  REPL_DRRIP,   // set-dueling between SRRIP and BRRIP
+  REPL_LFU,     // least frequently used, saturating count per way
+  NUM_REPL_POLICIES
+} Repl_Policy_Type;
+
+//////////////////////////////////////////////////////////////////
+// Each policy keeps its own per-set state in c->repl_state, as a
+// single allocation so cache_delete() can release it with free().
+// hit() is called on every hit, victim() only when the set is full,
+// insert() after a line is installed (in an empty way or a victim).
+// set_local is TRUE when a set's decisions depend only on that set's
+// own history, so disjoint groups of sets can be simulated apart.
+//////////////////////////////////////////////////////////////////
+
+struct Repl_Policy {
+  char  *name;
+  Flag   set_local;
+  void  *(*init)  (uns64 num_sets, uns64 num_ways);
+  void   (*hit)   (Cache *c, uns64 set, uns way);
+  uns    (*victim)(Cache *c, uns64 set);
+  void   (*insert)(Cache *c, uns64 set, uns way);
+};
+
+const Repl_Policy *repl_policy_get(uns64 repl_policy);
+
+#endif // REPL_H
@@ -0,0 +1,203 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reuse.h"
+
+#define REUSE_NO_LINE   (~(Addr)0)
+#define REUSE_MIN_TIMES 65536
+#define REUSE_MIN_TABLE 4096
+
+static char *access_type_name[NUM_ACCESS_TYPES] = {"IFETCH", "LOAD", "STORE"};
+
+static uns64 reuse_hash(Addr lineaddr){
+  return (lineaddr * 0x9e3779b97f4a7c15ULL) >> 20;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+Reuse_Dist *reuse_new(void){
+  Reuse_Dist *rd = (Reuse_Dist *) calloc (1, sizeof (Reuse_Dist));
+
+  rd->capacity = REUSE_MIN_TIMES;
+  rd->tree = (uns32 *) calloc (rd->capacity + 1, sizeof(uns32));
+  rd->line_at = (Addr *) malloc (rd->capacity * sizeof(Addr));
+
+  rd->table_mask = REUSE_MIN_TABLE - 1;
+  rd->key = (Addr *) malloc (REUSE_MIN_TABLE * sizeof(Addr));
+  rd->last = (uns64 *) malloc (REUSE_MIN_TABLE * sizeof(uns64));
+  memset(rd->key, 0xff, REUSE_MIN_TABLE * sizeof(Addr)); // every slot starts as REUSE_NO_LINE
+
+  return rd;
+}
+
+void reuse_delete(Reuse_Dist *rd){
+  free(rd->last);
+  free(rd->key);
+  free(rd->line_at);
+  free(rd->tree);
+  free(rd);
+}
+
+////////////////////////////////////////////////////////////////////
+// Fenwick tree, time t at index t+1
+////////////////////////////////////////////////////////////////////
+
+static void reuse_tree_add(Reuse_Dist *rd, uns64 t, int delta){
+  for(uns64 i = t + 1; i <= rd->capacity; i += i & (~i + 1)){
+    rd->tree[i] += delta;
+  }
+}
+
+// Number of lines last touched at times 0..t
+static uns64 reuse_tree_sum(Reuse_Dist *rd, uns64 t){
+  uns64 sum = 0;
+  for(uns64 i = t + 1; i; i -= i & (~i + 1)){
+    sum += rd->tree[i];
+  }
+  return sum;
+}
+
+////////////////////////////////////////////////////////////////////
+// Line table: linear probing, doubled when half full
+////////////////////////////////////////////////////////////////////
+
+static uns64 reuse_slot(Addr *key, uns64 mask, Addr lineaddr){
+  uns64 i = reuse_hash(lineaddr) & mask;
+  while(key[i] != lineaddr && key[i] != REUSE_NO_LINE){
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static void reuse_table_grow(Reuse_Dist *rd){
+  uns64 size = 2 * (rd->table_mask + 1);
+  Addr *key = (Addr *) malloc (size * sizeof(Addr));
+  uns64 *last = (uns64 *) malloc (size * sizeof(uns64));
+  memset(key, 0xff, size * sizeof(Addr));
+  for(uns64 i = 0; i <= rd->table_mask; i++){
+    if(rd->key[i] != REUSE_NO_LINE){
+      uns64 j = reuse_slot(key, size - 1, rd->key[i]);
+      key[j] = rd->key[i];
+      last[j] = rd->last[i];
+    }
+  }
+  free(rd->key);
+  free(rd->last);
+  rd->key = key;
+  rd->last = last;
+  rd->table_mask = size - 1;
+}
+
+////////////////////////////////////////////////////////////////////
+// Out of times: give the live lines times 0..num_lines-1 in their
+// old order, so distances are unchanged. Capacity stays at least
+// twice the number of lines, so this happens at most every
+// capacity/2 accesses.
+////////////////////////////////////////////////////////////////////
+
+static void reuse_renumber(Reuse_Dist *rd){
+  uns64 t = 0;
+  for(uns64 old = 0; old < rd->now; old++){
+    Addr lineaddr = rd->line_at[old];
+    if(lineaddr != REUSE_NO_LINE){
+      rd->last[reuse_slot(rd->key, rd->table_mask, lineaddr)] = t;
+      rd->line_at[t++] = lineaddr;
+    }
+  }
+  assert(t == rd->num_lines);
+  rd->now = t;
+
+  if(2 * rd->num_lines > rd->capacity){
+    rd->capacity *= 2;
+    free(rd->tree);
+    rd->tree = (uns32 *) malloc ((rd->capacity + 1) * sizeof(uns32));
+    rd->line_at = (Addr *) realloc (rd->line_at, rd->capacity * sizeof(Addr));
+  }
+
+  // linear-time build: every live time holds a 1
+  memset(rd->tree, 0, (rd->capacity + 1) * sizeof(uns32));
+  for(uns64 i = 1; i <= rd->capacity; i++){
+    if(i <= t){
+      rd->tree[i]++;
+    }
+    uns64 parent = i + (i & (~i + 1));
+    if(parent <= rd->capacity){
+      rd->tree[parent] += rd->tree[i];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Record one access; returns its reuse distance, or REUSE_COLD
+////////////////////////////////////////////////////////////////////
+
+uns64 reuse_access(Reuse_Dist *rd, Addr lineaddr, Access_Type type){
+  if(rd->now == rd->capacity){
+    reuse_renumber(rd);
+  }
+  rd->stat_access[type]++;
+
+  uns64 slot = reuse_slot(rd->key, rd->table_mask, lineaddr);
+  uns64 dist = REUSE_COLD;
+
+  if(rd->key[slot] == lineaddr){
+    uns64 t = rd->last[slot];
+    // every line's 1 is at or before now-1, so the ones after t are
+    // all the lines minus those up to t
+    dist = rd->num_lines - reuse_tree_sum(rd, t);
+    reuse_tree_add(rd, t, -1);
+    rd->line_at[t] = REUSE_NO_LINE;
+
+    uns64 bin = 0;
+    while(bin < REUSE_BINS - 1 && (1ULL << bin) <= dist){
+      bin++;
+    }
+    rd->hist[type][bin]++;
+  } else {
+    rd->stat_cold[type]++;
+    rd->key[slot] = lineaddr;
+    rd->num_lines++;
+  }
+
+  rd->last[slot] = rd->now;
+  rd->line_at[rd->now] = lineaddr;
+  reuse_tree_add(rd, rd->now, 1);
+  rd->now++;
+
+  if(2 * rd->num_lines > rd->table_mask + 1){
+    reuse_table_grow(rd);
+  }
+  return dist;
+}
+
+////////////////////////////////////////////////////////////////////
+// One line per non-empty bin and access type
+////////////////////////////////////////////////////////////////////
+
+void reuse_print_stats(Reuse_Dist *rd, char *header){
+  for(uns type = 0; type < NUM_ACCESS_TYPES; type++){
+    if(rd->stat_access[type] == 0){
+      continue;
+    }
+    printf("\n%s_%s_ACCESS \t\t : %10llu", header, access_type_name[type], rd->stat_access[type]);
+    printf("\n%s_%s_COLD   \t\t : %10llu", header, access_type_name[type], rd->stat_cold[type]);
+    for(uns64 bin = 0; bin < REUSE_BINS; bin++){
+      if(rd->hist[type][bin] == 0){
+        continue;
+      }
+      uns64 lo = bin ? (1ULL << (bin - 1)) : 0;
+      uns64 hi = bin ? (1ULL << bin) - 1 : 0;
+      if(bin == REUSE_BINS - 1){
+        printf("\n%s_%s_REUSE \t dist %10llu+           : %10llu",
+               header, access_type_name[type], lo, rd->hist[type][bin]);
+      } else {
+        printf("\n%s_%s_REUSE \t dist %10llu-%-10llu : %10llu",
+               header, access_type_name[type], lo, hi, rd->hist[type][bin]);
+      }
+    }
+  }
+  printf("\n");
+}
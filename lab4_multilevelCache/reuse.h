@@ -0,0 +1,44 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+#include "types.h"
+
+typedef struct Reuse_Dist Reuse_Dist;
+
+#define REUSE_BINS 33  // bin 0: distance 0, bin b: 2^(b-1) .. 2^b-1
+#define REUSE_COLD (~(uns64)0) // reuse_access() on a first touch
+
+//////////////////////////////////////////////////////////////////
+// Reuse-distance profiler: for every access, the number of distinct
+// lines touched since the previous access to the same line (its
+// depth in one fully-associative LRU stack), binned by powers of two
+// and split by access type. First touches are counted as cold.
+//
+// Each line's last access time is kept in a hash table. A Fenwick
+// tree over access times has a 1 at each line's last access, so the
+// lines touched since time t are the 1s after t: O(log n) per access.
+// When the times run out, the live ones are renumbered in order.
+//////////////////////////////////////////////////////////////////
+
+struct Reuse_Dist {
+  uns64  capacity;   // access times before renumbering
+  uns64  now;        // next access time
+  uns32 *tree;       // Fenwick tree over times 1..capacity
+  Addr  *line_at;    // [time] line last touched then, or none
+
+  Addr  *key;        // open-addressing table: line ...
+  uns64 *last;       // ... and the time it was last touched
+  uns64  table_mask;
+  uns64  num_lines;
+
+  uns64 hist[NUM_ACCESS_TYPES][REUSE_BINS];
+  uns64 stat_cold[NUM_ACCESS_TYPES];
+  uns64 stat_access[NUM_ACCESS_TYPES];
+};
+
+Reuse_Dist *reuse_new(void);
+void        reuse_delete(Reuse_Dist *rd);
+uns64       reuse_access(Reuse_Dist *rd, Addr lineaddr, Access_Type type);
+void        reuse_print_stats(Reuse_Dist *rd, char *header);
+
+#endif // REUSE_H
@@ -0,0 +1,199 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "shard.h"
+#include "repl.h"
+
+typedef struct Shard_Run Shard_Run;
+
+////////////////////////////////////////////////////////////////////
+// The trace is cut into num_shards equal chunks. Worker i first
+// counts, then scatters, chunk i into per-shard buckets (chunk order
+// is kept, so each bucket stays in trace order), and finally replays
+// bucket i against private copies of the Memsys and dcache structs.
+// The copies share the sets, tags and replacement state of the real
+// dcache, but only ever touch the sets of their own shard.
+////////////////////////////////////////////////////////////////////
+
+struct Shard_Run {
+  Memsys    *sys;
+  Trace     *trace;
+  uns64      num_shards;
+
+  uns64     *count;   // [chunk][shard] records of the shard in the chunk
+  Trace_Rec *bucket;  // all records, grouped by shard
+
+  Memsys    *shard_sys;
+  Cache     *shard_dcache;
+
+  pthread_barrier_t barrier;
+};
+
+typedef struct Shard_Arg {
+  Shard_Run *run;
+  uns64      id;
+} Shard_Arg;
+
+
+static uns64 shard_of(Shard_Run *run, Trace_Rec rec){
+  Cache *c = run->sys->dcache;
+  uns64 set = cache_set_index(c, trace_rec_addr(rec) / run->sys->cfg.linesize);
+  return set * run->num_shards / c->num_sets;
+}
+
+static void *shard_worker(void *arg){
+  Shard_Run *run = ((Shard_Arg *) arg)->run;
+  uns64 id = ((Shard_Arg *) arg)->id;
+  uns64 n = run->num_shards;
+  Trace_Rec *rec = run->trace->recs;
+  uns64 first = run->trace->num_recs * id / n;
+  uns64 last = run->trace->num_recs * (id + 1) / n;
+  uns64 *count = run->count + id * n;
+
+  for(uns64 i = first; i < last; i++){
+    count[shard_of(run, rec[i])]++;
+  }
+
+  pthread_barrier_wait(&run->barrier);
+
+  // where this chunk's records of each shard go: after every earlier
+  // shard, and after this shard's records from earlier chunks
+  uns64 *next = (uns64 *) calloc (n, sizeof(uns64));
+  uns64 base = 0;
+  for(uns64 s = 0; s < n; s++){
+    next[s] = base;
+    for(uns64 chunk = 0; chunk < n; chunk++){
+      if(chunk < id){
+        next[s] += run->count[chunk * n + s];
+      }
+      base += run->count[chunk * n + s];
+    }
+  }
+  uns64 start = 0;
+  for(uns64 s = 0; s < id; s++){
+    for(uns64 chunk = 0; chunk < n; chunk++){
+      start += run->count[chunk * n + s];
+    }
+  }
+
+  for(uns64 i = first; i < last; i++){
+    run->bucket[next[shard_of(run, rec[i])]++] = rec[i];
+  }
+  free(next);
+
+  pthread_barrier_wait(&run->barrier);
+
+  uns64 len = 0;
+  for(uns64 chunk = 0; chunk < n; chunk++){
+    len += run->count[chunk * n + id];
+  }
+
+  Memsys *sys = &run->shard_sys[id];
+  for(uns64 i = start; i < start + len; i++){
+    memsys_access(sys, trace_rec_addr(run->bucket[i]), trace_rec_type(run->bucket[i]));
+  }
+
+  return NULL;
+}
+
+
+static void shard_replay(Memsys *sys, Trace *trace, uns64 i){
+  if(trace->pcs){
+    memsys_access_pc(sys, trace_rec_addr(trace->recs[i]), trace_rec_type(trace->recs[i]), trace->pcs[i]);
+  } else {
+    memsys_access(sys, trace_rec_addr(trace->recs[i]), trace_rec_type(trace->recs[i]));
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void memsys_run_sharded(Memsys *sys, Trace *trace, uns64 num_shards){
+  if(num_shards > sys->dcache->num_sets){
+    num_shards = sys->dcache->num_sets;
+  }
+
+  // the warmup accesses (cfg.warmup_accesses) run first, in order,
+  // and only the rest is split
+  uns64 warm = 0;
+  while(warm < trace->num_recs && sys->warmup_left){
+    shard_replay(sys, trace, warm++);
+  }
+  Trace rest = *trace;
+  rest.num_recs -= warm;
+  rest.recs += warm;
+  if(rest.pcs){
+    rest.pcs += warm;
+  }
+  if(rest.cores){
+    rest.cores += warm;
+  }
+  trace = &rest;
+
+  if(num_shards <= 1 || sys->cfg.sim_mode != SIM_MODE_A || sys->sd_dcache || sys->rd_dcache || sys->dcache->threec
+     || sys->interval || sys->functional || sys->dcache->index_fn == INDEX_SKEW
+     || !sys->dcache->repl->set_local){
+    for(uns64 i = 0; i < trace->num_recs; i++){
+      shard_replay(sys, trace, i);
+    }
+    return;
+  }
+
+  Shard_Run run;
+  memset(&run, 0, sizeof(Shard_Run));
+  run.sys = sys;
+  run.trace = trace;
+  run.num_shards = num_shards;
+  run.count = (uns64 *) calloc (num_shards * num_shards, sizeof(uns64));
+  run.bucket = (Trace_Rec *) malloc (trace->num_recs * sizeof(Trace_Rec));
+  run.shard_sys = (Memsys *) calloc (num_shards, sizeof(Memsys));
+  run.shard_dcache = (Cache *) calloc (num_shards, sizeof(Cache));
+  pthread_barrier_init(&run.barrier, NULL, num_shards);
+
+  for(uns64 s = 0; s < num_shards; s++){
+    run.shard_dcache[s] = *sys->dcache;
+    cache_clear_stats(&run.shard_dcache[s]);
+    run.shard_sys[s] = *sys;
+    run.shard_sys[s].dcache = &run.shard_dcache[s];
+    run.shard_sys[s].stat_ifetch_access = 0;
+    run.shard_sys[s].stat_load_access = 0;
+    run.shard_sys[s].stat_store_access = 0;
+    run.shard_sys[s].stat_ifetch_delay = 0;
+    run.shard_sys[s].stat_load_delay = 0;
+    run.shard_sys[s].stat_store_delay = 0;
+  }
+
+  pthread_t *threads = (pthread_t *) calloc (num_shards, sizeof(pthread_t));
+  Shard_Arg *args = (Shard_Arg *) calloc (num_shards, sizeof(Shard_Arg));
+  for(uns64 s = 0; s < num_shards; s++){
+    args[s].run = &run;
+    args[s].id = s;
+    pthread_create(&threads[s], NULL, shard_worker, &args[s]);
+  }
+  for(uns64 s = 0; s < num_shards; s++){
+    pthread_join(threads[s], NULL);
+  }
+
+  // merge in shard order; the sums do not depend on thread timing
+  for(uns64 s = 0; s < num_shards; s++){
+    Memsys *part = &run.shard_sys[s];
+    cache_add_stats(sys->dcache, part->dcache);
+    sys->stat_ifetch_access += part->stat_ifetch_access;
+    sys->stat_load_access += part->stat_load_access;
+    sys->stat_store_access += part->stat_store_access;
+    sys->stat_ifetch_delay += part->stat_ifetch_delay;
+    sys->stat_load_delay += part->stat_load_delay;
+    sys->stat_store_delay += part->stat_store_delay;
+  }
+
+  pthread_barrier_destroy(&run.barrier);
+  free(args);
+  free(threads);
+  free(run.shard_dcache);
+  free(run.shard_sys);
+  free(run.bucket);
+  free(run.count);
+}
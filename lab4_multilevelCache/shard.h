@@ -0,0 +1,24 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "types.h"
+#include "memsys.h"
+#include "trace.h"
+
+//////////////////////////////////////////////////////////////////
+// Set-sharded replay of a trace through a SIM_MODE_A memory system.
+//
+// In mode A only the dcache is simulated and its sets never interact,
+// so the trace is split by set index into num_shards contiguous set
+// ranges and each range is replayed on its own thread, keeping the
+// original order within the range. Stats are summed at the end, so
+// the result is bit-identical to a serial replay.
+//
+// Falls back to a serial replay when that would not hold: other
+// modes, stack-distance profiling, or a replacement policy with
+// state shared across sets (BRRIP, DRRIP).
+//////////////////////////////////////////////////////////////////
+
+void memsys_run_sharded(Memsys *sys, Trace *trace, uns64 num_shards);
+
+#endif // SHARD_H
@@ -0,0 +1,129 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stackdist.h"
+
+#define STACK_EMPTY (~(Addr)0)
+
+static char *access_type_name[NUM_ACCESS_TYPES] = {"IFETCH", "LOAD", "STORE"};
+
+static uns64 *stackdist_hist(Stack_Dist *sd, uns type, uns64 level){
+  return sd->hist + (type * sd->num_levels + level) * (sd->max_ways + 1);
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+Stack_Dist *stackdist_new(uns64 max_sets, uns64 max_ways){
+  Stack_Dist *sd = (Stack_Dist *) calloc (1, sizeof (Stack_Dist));
+
+  if(max_sets == 0 || (max_sets & (max_sets - 1))){
+    printf("Stack distance max sets (%llu) must be a power of two\n", max_sets);
+    exit(-1);
+  }
+
+  sd->max_ways = max_ways;
+  while((1ULL << sd->num_levels) <= max_sets){
+    sd->num_levels++;
+  }
+
+  sd->stack = (Addr **) calloc (sd->num_levels, sizeof(Addr *));
+  for(uns64 level = 0; level < sd->num_levels; level++){
+    uns64 bytes = (1ULL << level) * max_ways * sizeof(Addr);
+    sd->stack[level] = (Addr *) malloc (bytes);
+    memset(sd->stack[level], 0xff, bytes); // every entry starts as STACK_EMPTY
+  }
+
+  sd->hist = (uns64 *) calloc (NUM_ACCESS_TYPES * sd->num_levels * (max_ways + 1), sizeof(uns64));
+
+  return sd;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void stackdist_delete(Stack_Dist *sd){
+  for(uns64 level = 0; level < sd->num_levels; level++){
+    free(sd->stack[level]);
+  }
+  free(sd->stack);
+  free(sd->hist);
+  free(sd);
+}
+
+////////////////////////////////////////////////////////////////////
+// Find lineaddr in the stack of its set at every set count, record
+// the depth, and move it to the top (an LRU access)
+////////////////////////////////////////////////////////////////////
+
+void stackdist_access(Stack_Dist *sd, Addr lineaddr, Access_Type type){
+  sd->stat_access[type]++;
+
+  for(uns64 level = 0; level < sd->num_levels; level++){
+    uns64 set = lineaddr & ((1ULL << level) - 1);
+    Addr *stack = sd->stack[level] + set * sd->max_ways;
+
+    uns64 depth = 0;
+    while(depth < sd->max_ways && stack[depth] != lineaddr && stack[depth] != STACK_EMPTY){
+      depth++;
+    }
+
+    if(depth < sd->max_ways && stack[depth] == lineaddr){
+      stackdist_hist(sd, type, level)[depth]++;
+    } else {
+      // not within max_ways: a miss at every tracked associativity
+      stackdist_hist(sd, type, level)[sd->max_ways]++;
+      if(depth == sd->max_ways){
+        depth--; // drop the bottom entry
+      }
+    }
+
+    memmove(stack + 1, stack, depth * sizeof(Addr));
+    stack[0] = lineaddr;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Misses of an LRU cache with num_sets sets and num_ways ways
+////////////////////////////////////////////////////////////////////
+
+uns64 stackdist_misses(Stack_Dist *sd, Access_Type type, uns64 num_sets, uns64 num_ways){
+  uns64 level = 0;
+  while((1ULL << level) < num_sets){
+    level++;
+  }
+  assert(level < sd->num_levels && (1ULL << level) == num_sets);
+  assert(num_ways >= 1 && num_ways <= sd->max_ways);
+
+  uns64 *hist = stackdist_hist(sd, type, level);
+  uns64 misses = sd->stat_access[type];
+  for(uns64 depth = 0; depth < num_ways; depth++){
+    misses -= hist[depth];
+  }
+  return misses;
+}
+
+////////////////////////////////////////////////////////////////////
+// Miss-ratio curve: one line per (sets, ways) point and access type
+////////////////////////////////////////////////////////////////////
+
+void stackdist_print_stats(Stack_Dist *sd, char *header, uns64 linesize){
+  for(uns type = 0; type < NUM_ACCESS_TYPES; type++){
+    if(sd->stat_access[type] == 0){
+      continue;
+    }
+    printf("\n%s_%s_ACCESS \t\t : %10llu", header, access_type_name[type], sd->stat_access[type]);
+    for(uns64 level = 0; level < sd->num_levels; level++){
+      for(uns64 ways = 1; ways <= sd->max_ways; ways++){
+        uns64 sets = 1ULL << level;
+        uns64 misses = stackdist_misses(sd, type, sets, ways);
+        double mr = (double)(misses)/(double)(sd->stat_access[type]);
+        printf("\n%s_%s_MISSPERC \t sets %8llu ways %3llu size %10lluB : %10.3f",
+               header, access_type_name[type], sets, ways, sets * ways * linesize, 100*mr);
+      }
+    }
+  }
+  printf("\n");
+}
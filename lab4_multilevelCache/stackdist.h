@@ -0,0 +1,34 @@
+#ifndef STACKDIST_H
+#define STACKDIST_H
+
+#include "types.h"
+
+typedef struct Stack_Dist Stack_Dist;
+
+//////////////////////////////////////////////////////////////////
+// Mattson stack-distance profiler. One pass over a line-address
+// stream gives the exact LRU miss count of every cache with a
+// power-of-two number of sets up to max_sets and 1..max_ways ways.
+//
+// For each set count there is one LRU stack per set, kept max_ways
+// deep. A hit at depth d means the access hits in every cache of
+// that set count with more than d ways.
+//////////////////////////////////////////////////////////////////
+
+struct Stack_Dist {
+  uns64 num_levels; // set counts 1, 2, 4 ... max_sets
+  uns64 max_ways;
+
+  Addr  **stack;    // [level][set*max_ways + depth], MRU first
+  uns64 *hist;      // [type][level][depth], depth max_ways = deeper
+
+  uns64 stat_access[NUM_ACCESS_TYPES];
+};
+
+Stack_Dist *stackdist_new(uns64 max_sets, uns64 max_ways);
+void        stackdist_delete(Stack_Dist *sd);
+void        stackdist_access(Stack_Dist *sd, Addr lineaddr, Access_Type type);
+uns64       stackdist_misses(Stack_Dist *sd, Access_Type type, uns64 num_sets, uns64 num_ways);
+void        stackdist_print_stats(Stack_Dist *sd, char *header, uns64 linesize);
+
+#endif // STACKDIST_H
@@ -0,0 +1,542 @@
+/////////////////////////////////////////////////////////////////////
+// Configuration sweep driver
+//
+// Usage: sweep <trace> <configs> [-threads N] [-shards N] [-warmup trace]
+//              [-out results.csv]
+//
+// The trace (text, or binary from tracecvt) is decoded or mapped
+// once and shared read-only by every run. Each
+// non-comment line of <configs> is one memory system, given as
+// key=value pairs; keys left out keep the lab defaults below:
+//
+//   mode=A|B|C  linesize=64  repl=0
+//   dsize=32KB  dassoc=8  isize=32KB  iassoc=8  l2size=1MB  l2assoc=16
+//                                (any *assoc=0: fully associative)
+//   dpf=0  dpfdeg=1  dpfdist=1   (likewise ipf*, l2pf*; see prefetch.h)
+//   dmshr=0  l2mshr=32           (dmshr > 0: non-blocking timing, see mshr.h)
+//   incl=0                       (0 NINE, 1 inclusive, 2 exclusive L2)
+//   dvc=0                        (DCACHE victim cache entries)
+//   dports=0  dbanks=0           (DCACHE accesses per cycle, 0 = unlimited;
+//                                 word-interleaved banks, 0 or 1 = one)
+//   dwp=0  iwp=0                 (L1 way prediction: 0 none, 1 MRU, 2 PC)
+//   didx=0  iidx=0  l2idx=0      (set index: 0 modulo, 1 XOR, 2 prime, 3 skewed;
+//                                 sizes need not give power-of-two sets for 0/2)
+//   threec=0                     (1: classify misses, see threec.h)
+//   interval=0  intervalcyc=0    (counter deltas every N accesses/cycles, see
+//   intervalout=intervals_<row>.csv                           interval.h)
+//   wt=0  wmiss=0  wbuf=0        (write-through; 0 allocate, 1 no-allocate,
+//                                 2 validate; write buffer entries)
+//   l2sample=0                   (simulate 1 in N L2 sets, see cache_enable_sampling)
+//   sectors=1                    (sectors per line in every cache, see cache_set_sectors)
+//   warmup=0                     (first N accesses only warm the caches)
+//   hier=<file>                  (cache levels from a file instead of the
+//                                 d*/i*/l2* caches, see hier.h)
+//   cores=1  l2banks=0           (cores > 1: shared L2, MESI, see multicore.h)
+//   dram=0  dramch=1  dramranks=1  drambanks=16  dramrow=1KB  drampage=0
+//   trcd=45  tcas=45  trp=45  tburst=10  dramwq=32  (dram=1: banked, see dramctrl.h)
+//   tlbpage=0  itlb=128  itlbassoc=8  dtlb=64  dtlbassoc=4  stlb=1536  stlbassoc=12
+//   stlblat=7                    (tlbpage=4KB or 2MB: TLBs and page walks, see tlb.h)
+//
+// Runs are spread over a pool of worker threads that each pull the
+// next pending configuration. One row per configuration is written
+// to the results table, in config-file order.
+//
+// With -warmup, every single-core run first warms its caches with that trace,
+// through the functional path, and counts only the main trace.
+//
+// With -shards N, each mode A run is itself split by set index over
+// N threads (see shard.h), for sweeps with few, long runs.
+//
+// Multicore rows report the sums over all cores; cycles is the
+// slowest core's.
+/////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "memsys.h"
+#include "trace.h"
+#include "shard.h"
+#include "multicore.h"
+
+//---- Knobs memsys_new() would read; sweep runs use Memsys_Config ------
+
+MODE   SIM_MODE       = SIM_MODE_B;
+uns64  CACHE_LINESIZE = 64;
+uns64  REPL_POLICY    = 0;
+
+uns64  DCACHE_SIZE    = 32*1024;
+uns64  DCACHE_ASSOC   = 8;
+uns64  ICACHE_SIZE    = 32*1024;
+uns64  ICACHE_ASSOC   = 8;
+uns64  L2CACHE_SIZE   = 1024*1024;
+uns64  L2CACHE_ASSOC  = 16;
+
+uns64  cycle_count    = 0;
+
+typedef struct Sweep_Job Sweep_Job;
+
+struct Sweep_Job {
+  Memsys_Config cfg;
+  Memsys       *sys;   // kept after the run for its stats
+  Multicore    *mc;    // multicore runs only; sys is then &mc->total
+};
+
+typedef struct Sweep {
+  Trace     *trace;
+  Trace     *warmup;     // NULL unless -warmup is given
+  Sweep_Job *jobs;
+  uns64      num_jobs;
+  uns64      num_shards; // threads per mode A run
+  uns64      next_job; // taken with an atomic add by the workers
+} Sweep;
+
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+static uns64 parse_size(char *key, char *val){
+  char *end;
+  uns64 size = strtoull(val, &end, 10);
+  if(end == val){
+    printf("Bad value for %s: %s\n", key, val);
+    exit(-1);
+  }
+  if(!strcmp(end, "KB")){
+    size *= 1024;
+  } else if(!strcmp(end, "MB")){
+    size *= 1024*1024;
+  } else if(*end){
+    printf("Bad value for %s: %s\n", key, val);
+    exit(-1);
+  }
+  return size;
+}
+
+static void parse_config(Memsys_Config *cfg, char *line){
+  for(char *tok = strtok(line, " \t\n"); tok; tok = strtok(NULL, " \t\n")){
+    char *val = strchr(tok, '=');
+    if(val == NULL){
+      printf("Expected key=value in config, got %s\n", tok);
+      exit(-1);
+    }
+    *val++ = '\0';
+
+    if(!strcmp(tok, "mode")){
+      if(val[0] < 'A' || val[0] >= 'A' + NUM_SIM_MODES || val[1]){
+        printf("Bad mode %s\n", val);
+        exit(-1);
+      }
+      cfg->sim_mode = (MODE) (SIM_MODE_A + (val[0] - 'A'));
+    } else if(!strcmp(tok, "linesize")){
+      cfg->linesize = parse_size(tok, val);
+    } else if(!strcmp(tok, "repl")){
+      cfg->repl_policy = parse_size(tok, val);
+    } else if(!strcmp(tok, "dsize")){
+      cfg->dcache_size = parse_size(tok, val);
+    } else if(!strcmp(tok, "dassoc")){
+      cfg->dcache_assoc = parse_size(tok, val);
+    } else if(!strcmp(tok, "isize")){
+      cfg->icache_size = parse_size(tok, val);
+    } else if(!strcmp(tok, "iassoc")){
+      cfg->icache_assoc = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2size")){
+      cfg->l2cache_size = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2assoc")){
+      cfg->l2cache_assoc = parse_size(tok, val);
+    } else if(!strcmp(tok, "dpf")){
+      cfg->dcache_pf.policy = parse_size(tok, val);
+    } else if(!strcmp(tok, "dpfdeg")){
+      cfg->dcache_pf.degree = parse_size(tok, val);
+    } else if(!strcmp(tok, "dpfdist")){
+      cfg->dcache_pf.distance = parse_size(tok, val);
+    } else if(!strcmp(tok, "ipf")){
+      cfg->icache_pf.policy = parse_size(tok, val);
+    } else if(!strcmp(tok, "ipfdeg")){
+      cfg->icache_pf.degree = parse_size(tok, val);
+    } else if(!strcmp(tok, "ipfdist")){
+      cfg->icache_pf.distance = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2pf")){
+      cfg->l2cache_pf.policy = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2pfdeg")){
+      cfg->l2cache_pf.degree = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2pfdist")){
+      cfg->l2cache_pf.distance = parse_size(tok, val);
+    } else if(!strcmp(tok, "dmshr")){
+      cfg->dcache_mshrs = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2mshr")){
+      cfg->l2cache_mshrs = parse_size(tok, val);
+    } else if(!strcmp(tok, "incl")){
+      cfg->l2cache_inclusion = parse_size(tok, val);
+    } else if(!strcmp(tok, "dvc")){
+      cfg->dcache_victims = parse_size(tok, val);
+    } else if(!strcmp(tok, "threec")){
+      cfg->classify_misses = parse_size(tok, val);
+    } else if(!strcmp(tok, "interval")){
+      cfg->interval_accesses = parse_size(tok, val);
+    } else if(!strcmp(tok, "intervalcyc")){
+      cfg->interval_cycles = parse_size(tok, val);
+    } else if(!strcmp(tok, "intervalout")){
+      cfg->interval_file = strdup(val);
+    } else if(!strcmp(tok, "dports")){
+      cfg->dcache_ports = parse_size(tok, val);
+    } else if(!strcmp(tok, "dbanks")){
+      cfg->dcache_banks = parse_size(tok, val);
+    } else if(!strcmp(tok, "dwp")){
+      cfg->dcache_way_pred = parse_size(tok, val);
+    } else if(!strcmp(tok, "iwp")){
+      cfg->icache_way_pred = parse_size(tok, val);
+    } else if(!strcmp(tok, "didx")){
+      cfg->dcache_index = parse_size(tok, val);
+    } else if(!strcmp(tok, "iidx")){
+      cfg->icache_index = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2idx")){
+      cfg->l2cache_index = parse_size(tok, val);
+    } else if(!strcmp(tok, "wt")){
+      cfg->dcache_write_through = parse_size(tok, val);
+    } else if(!strcmp(tok, "wmiss")){
+      cfg->dcache_write_miss = parse_size(tok, val);
+    } else if(!strcmp(tok, "wbuf")){
+      cfg->dcache_write_buffer = parse_size(tok, val);
+    } else if(!strcmp(tok, "cores")){
+      cfg->num_cores = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2sample")){
+      cfg->l2cache_sampling = parse_size(tok, val);
+    } else if(!strcmp(tok, "warmup")){
+      cfg->warmup_accesses = parse_size(tok, val);
+    } else if(!strcmp(tok, "hier")){
+      cfg->hierarchy_file = strdup(val);
+    } else if(!strcmp(tok, "sectors")){
+      cfg->sectors = parse_size(tok, val);
+    } else if(!strcmp(tok, "l2banks")){
+      cfg->l2cache_banks = parse_size(tok, val);
+    } else if(!strcmp(tok, "dram")){
+      cfg->dram.model = parse_size(tok, val);
+    } else if(!strcmp(tok, "dramch")){
+      cfg->dram.channels = parse_size(tok, val);
+    } else if(!strcmp(tok, "dramranks")){
+      cfg->dram.ranks = parse_size(tok, val);
+    } else if(!strcmp(tok, "drambanks")){
+      cfg->dram.banks = parse_size(tok, val);
+    } else if(!strcmp(tok, "dramrow")){
+      cfg->dram.row_bytes = parse_size(tok, val);
+    } else if(!strcmp(tok, "drampage")){
+      cfg->dram.page_policy = parse_size(tok, val);
+    } else if(!strcmp(tok, "trcd")){
+      cfg->dram.t_rcd = parse_size(tok, val);
+    } else if(!strcmp(tok, "tcas")){
+      cfg->dram.t_cas = parse_size(tok, val);
+    } else if(!strcmp(tok, "trp")){
+      cfg->dram.t_rp = parse_size(tok, val);
+    } else if(!strcmp(tok, "tburst")){
+      cfg->dram.t_burst = parse_size(tok, val);
+    } else if(!strcmp(tok, "dramwq")){
+      cfg->dram.write_queue = parse_size(tok, val);
+    } else if(!strcmp(tok, "tlbpage")){
+      cfg->tlb.page_size = parse_size(tok, val);
+    } else if(!strcmp(tok, "itlb")){
+      cfg->tlb.itlb_entries = parse_size(tok, val);
+    } else if(!strcmp(tok, "itlbassoc")){
+      cfg->tlb.itlb_assoc = parse_size(tok, val);
+    } else if(!strcmp(tok, "dtlb")){
+      cfg->tlb.dtlb_entries = parse_size(tok, val);
+    } else if(!strcmp(tok, "dtlbassoc")){
+      cfg->tlb.dtlb_assoc = parse_size(tok, val);
+    } else if(!strcmp(tok, "stlb")){
+      cfg->tlb.stlb_entries = parse_size(tok, val);
+    } else if(!strcmp(tok, "stlbassoc")){
+      cfg->tlb.stlb_assoc = parse_size(tok, val);
+    } else if(!strcmp(tok, "stlblat")){
+      cfg->tlb.stlb_latency = parse_size(tok, val);
+    } else {
+      printf("Unknown config key %s\n", tok);
+      exit(-1);
+    }
+  }
+}
+
+static void load_configs(Sweep *sw, char *filename){
+  FILE *fp = fopen(filename, "r");
+  if(fp == NULL){
+    printf("Unable to open config file %s\n", filename);
+    exit(-1);
+  }
+
+  uns64 max_jobs = 16;
+  sw->jobs = (Sweep_Job *) calloc (max_jobs, sizeof(Sweep_Job));
+
+  char line[1024];
+  while(fgets(line, sizeof(line), fp)){
+    char *p = line + strspn(line, " \t");
+    if(*p == '\n' || *p == '\0' || *p == '#'){
+      continue;
+    }
+    if(sw->num_jobs == max_jobs){
+      max_jobs *= 2;
+      sw->jobs = (Sweep_Job *) realloc (sw->jobs, max_jobs * sizeof(Sweep_Job));
+    }
+    Sweep_Job *job = &sw->jobs[sw->num_jobs++];
+    memset(job, 0, sizeof(Sweep_Job));
+    memsys_config_default(&job->cfg);
+    job->cfg.interval_file = NULL;
+    parse_config(&job->cfg, p);
+    if(job->cfg.interval_file == NULL){
+      // runs go in parallel, so each gets its own file
+      char name[64];
+      sprintf(name, "intervals_%llu.csv", sw->num_jobs - 1);
+      job->cfg.interval_file = strdup(name);
+    }
+  }
+
+  fclose(fp);
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Worker: take the next configuration until none are left. The runs
+// share nothing but the read-only trace.
+////////////////////////////////////////////////////////////////////
+
+static void *sweep_worker(void *arg){
+  Sweep *sw = (Sweep *) arg;
+
+  for(;;){
+    uns64 j = __atomic_fetch_add(&sw->next_job, 1, __ATOMIC_RELAXED);
+    if(j >= sw->num_jobs){
+      break;
+    }
+
+    if(sw->jobs[j].cfg.num_cores > 1){
+      Multicore *mc = multicore_new(&sw->jobs[j].cfg);
+      multicore_run(mc, sw->trace);
+      sw->jobs[j].mc = mc;
+      sw->jobs[j].sys = &mc->total;
+      continue;
+    }
+
+    Memsys *sys = memsys_new_config(&sw->jobs[j].cfg);
+    if(sw->warmup){
+      memsys_warm_trace(sys, sw->warmup);
+    }
+    memsys_run_sharded(sys, sw->trace, sw->num_shards);
+    sw->jobs[j].sys = sys;
+  }
+
+  return NULL;
+}
+
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+static double avg(uns64 total, uns64 count){
+  return count ? (double)(total)/(double)(count) : 0;
+}
+
+static void print_results(Sweep *sw, FILE *out){
+  fprintf(out, "mode,linesize,repl,dsize,dassoc,isize,iassoc,l2size,l2assoc,"
+               "ifetch_access,load_access,store_access,"
+               "ifetch_avgdelay,load_avgdelay,store_avgdelay,"
+               "dcache_read_miss,dcache_write_miss,dcache_dirty_evicts,"
+               "icache_read_miss,l2cache_read_miss,l2cache_write_miss,l2cache_dirty_evicts,"
+               "dram_read_access,dram_write_access,"
+               "dcache_pf_issued,dcache_pf_useful,icache_pf_issued,icache_pf_useful,"
+               "l2cache_pf_issued,l2cache_pf_useful,cycles,dcache_mlp,"
+               "dram_row_hit,dram_row_conflict,incl,back_invals,victim_fills,"
+               "dvc,vcache_hits,cores,l2banks,l2bank_wait,"
+               "coherence_misses,invalidations,upgrades,flushes,"
+               "wt,wmiss,wbuf,wbuf_coalesced,wbuf_full_cycles,"
+               "dwp,iwp,dcache_waypred_miss,icache_waypred_miss,"
+               "dcache_compulsory,dcache_capacity,dcache_conflict,"
+               "l2cache_compulsory,l2cache_capacity,l2cache_conflict,"
+               "l2sample,l2cache_est_read_miss,l2cache_est_read_miss_ci95,"
+               "didx,iidx,l2idx,"
+               "sectors,dcache_sector_miss,l2cache_sector_miss,l2_traffic_bytes,dram_traffic_bytes,"
+               "levels,llc_read_miss,llc_write_miss,llc_dirty_evicts,"
+               "tlbpage,itlb_miss,dtlb_miss,stlb_miss,page_walks,walk_avgdelay,"
+               "dports,dbanks,dcache_port_conflicts,dcache_bank_conflicts,dcache_port_wait\n");
+
+  for(uns64 j = 0; j < sw->num_jobs; j++){
+    Memsys_Config *cfg = &sw->jobs[j].cfg;
+    Memsys *sys = sw->jobs[j].sys;
+    Flag has_l2 = (cfg->sim_mode != SIM_MODE_A);
+
+    fprintf(out, "%c,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,",
+            'A' + (cfg->sim_mode - SIM_MODE_A), cfg->linesize, cfg->repl_policy,
+            cfg->dcache_size, cfg->dcache_assoc, cfg->icache_size, cfg->icache_assoc,
+            cfg->l2cache_size, cfg->l2cache_assoc);
+    fprintf(out, "%llu,%llu,%llu,%.3f,%.3f,%.3f,",
+            sys->stat_ifetch_access, sys->stat_load_access, sys->stat_store_access,
+            avg(sys->stat_ifetch_delay, sys->stat_ifetch_access),
+            avg(sys->stat_load_delay, sys->stat_load_access),
+            avg(sys->stat_store_delay, sys->stat_store_access));
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,",
+            sys->dcache->stat_read_miss, sys->dcache->stat_write_miss, sys->dcache->stat_dirty_evicts,
+            has_l2 ? sys->icache->stat_read_miss : 0,
+            has_l2 ? sys->l2cache->stat_read_miss : 0,
+            has_l2 ? sys->l2cache->stat_write_miss : 0,
+            has_l2 ? sys->l2cache->stat_dirty_evicts : 0,
+            sys->dramctrl ? sys->dramctrl->stat_read_access : has_l2 ? sys->dram->stat_read_access : 0,
+            sys->dramctrl ? sys->dramctrl->stat_write_access : has_l2 ? sys->dram->stat_write_access : 0);
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,%llu,",
+            sys->dcache_pf ? sys->dcache_pf->stat_issued : 0,
+            sys->dcache_pf ? sys->dcache_pf->stat_useful : 0,
+            sys->icache_pf ? sys->icache_pf->stat_issued : 0,
+            sys->icache_pf ? sys->icache_pf->stat_useful : 0,
+            sys->l2cache_pf ? sys->l2cache_pf->stat_issued : 0,
+            sys->l2cache_pf ? sys->l2cache_pf->stat_useful : 0);
+    fprintf(out, "%llu,%.3f,",
+            has_l2 ? memsys_cycles(sys) : 0,
+            sys->dcache_mshr ? avg(sys->dcache_mshr->stat_busy_sum, sys->dcache_mshr->stat_busy_cycles) : 0);
+    fprintf(out, "%llu,%llu,",
+            sys->dramctrl ? sys->dramctrl->stat_row_hit : 0,
+            sys->dramctrl ? sys->dramctrl->stat_row_conflict : 0);
+    fprintf(out, "%llu,%llu,%llu,",
+            cfg->l2cache_inclusion, sys->stat_back_invals, sys->stat_victim_fills);
+    fprintf(out, "%llu,%llu,", cfg->dcache_victims,
+            sys->vcache ? sys->vcache->stat_read_access + sys->vcache->stat_write_access
+                          - sys->vcache->stat_read_miss - sys->vcache->stat_write_miss : 0);
+    Multicore *mc = sw->jobs[j].mc;
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,%llu,%llu,",
+            mc ? mc->num_cores : 1, cfg->l2cache_banks, sys->stat_l2_bank_wait,
+            mc ? mc->stat_coherence_misses : 0,
+            mc ? mc->stat_invalidations : 0,
+            mc ? mc->stat_upgrades : 0,
+            mc ? mc->stat_flushes : 0);
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,",
+            cfg->dcache_write_through, cfg->dcache_write_miss, cfg->dcache_write_buffer,
+            sys->dcache_wbuf ? sys->dcache_wbuf->stat_coalesced : 0,
+            sys->dcache_wbuf ? sys->dcache_wbuf->stat_full_cycles : 0);
+    fprintf(out, "%llu,%llu,%llu,%llu,",
+            cfg->dcache_way_pred, cfg->icache_way_pred,
+            sys->dcache->stat_way_pred_miss, has_l2 ? sys->icache->stat_way_pred_miss : 0);
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,%llu,",
+            sys->dcache->stat_threec_miss[THREEC_COMPULSORY],
+            sys->dcache->stat_threec_miss[THREEC_CAPACITY],
+            sys->dcache->stat_threec_miss[THREEC_CONFLICT],
+            has_l2 ? sys->l2cache->stat_threec_miss[THREEC_COMPULSORY] : 0,
+            has_l2 ? sys->l2cache->stat_threec_miss[THREEC_CAPACITY] : 0,
+            has_l2 ? sys->l2cache->stat_threec_miss[THREEC_CONFLICT] : 0);
+    double est = has_l2 ? sys->l2cache->stat_read_miss : 0;
+    double ci95 = 0;
+    if(has_l2 && sys->l2cache->set_sampled){
+      cache_estimate_misses(sys->l2cache, FALSE, &est, &ci95);
+    }
+    fprintf(out, "%llu,%.0f,%.0f,", cfg->l2cache_sampling, est, ci95);
+    fprintf(out, "%llu,%llu,%llu,", cfg->dcache_index, cfg->icache_index, cfg->l2cache_index);
+    uns64 l2_bytes = 0, dram_bytes = 0;
+    if(has_l2){
+      memsys_traffic(sys, &l2_bytes, &dram_bytes);
+    }
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,", cfg->sectors > 1 ? cfg->sectors : 1,
+            sys->dcache->stat_sector_miss, has_l2 ? sys->l2cache->stat_sector_miss : 0,
+            l2_bytes, dram_bytes);
+    // the last level: the L2, or the last one in the hierarchy file,
+    // which can only miss to DRAM
+    Cache *llc = sys->hier ? sys->hier->level[sys->hier->num_levels - 1].cache : sys->l2cache;
+    fprintf(out, "%llu,%llu,%llu,%llu,",
+            sys->hier ? sys->hier->num_levels : has_l2 ? 3 : 1,
+            has_l2 ? llc->stat_read_miss : 0,
+            has_l2 ? llc->stat_write_miss : 0,
+            has_l2 ? llc->stat_dirty_evicts : 0);
+    TLB *tlb = sys->tlb;
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,%.3f,", tlb ? cfg->tlb.page_size : 0,
+            tlb ? tlb->itlb->stat_read_miss : 0,
+            tlb ? tlb->dtlb->stat_read_miss : 0,
+            tlb && tlb->stlb ? tlb->stlb->stat_read_miss : 0,
+            tlb ? tlb->stat_walks : 0,
+            tlb ? avg(tlb->stat_walk_delay, tlb->stat_walks) : 0);
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu\n", cfg->dcache_ports, cfg->dcache_banks,
+            sys->stat_dcache_port_conflicts, sys->stat_dcache_bank_conflicts, sys->stat_dcache_port_wait);
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv){
+  if(argc < 3){
+    printf("Usage: %s <trace> <configs> [-threads N] [-shards N] [-warmup trace] [-out results.csv]\n",
+           argv[0]);
+    exit(-1);
+  }
+
+  uns64 num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  uns64 num_shards = 1;
+  char *out_name = NULL;
+  char *warmup_name = NULL;
+  for(int i = 3; i < argc; i++){
+    if(!strcmp(argv[i], "-threads") && i + 1 < argc){
+      num_threads = strtoull(argv[++i], NULL, 10);
+    } else if(!strcmp(argv[i], "-shards") && i + 1 < argc){
+      num_shards = strtoull(argv[++i], NULL, 10);
+    } else if(!strcmp(argv[i], "-warmup") && i + 1 < argc){
+      warmup_name = argv[++i];
+    } else if(!strcmp(argv[i], "-out") && i + 1 < argc){
+      out_name = argv[++i];
+    } else {
+      printf("Unknown option %s\n", argv[i]);
+      exit(-1);
+    }
+  }
+
+  Sweep sw;
+  memset(&sw, 0, sizeof(Sweep));
+  sw.num_shards = num_shards;
+  load_configs(&sw, argv[2]);
+  sw.trace = trace_load(argv[1]);
+  if(warmup_name){
+    sw.warmup = trace_load(warmup_name);
+  }
+
+  if(num_threads > sw.num_jobs){
+    num_threads = sw.num_jobs;
+  }
+  if(num_threads == 0){
+    num_threads = 1;
+  }
+
+  pthread_t *threads = (pthread_t *) calloc (num_threads, sizeof(pthread_t));
+  for(uns64 t = 0; t < num_threads; t++){
+    pthread_create(&threads[t], NULL, sweep_worker, &sw);
+  }
+  for(uns64 t = 0; t < num_threads; t++){
+    pthread_join(threads[t], NULL);
+  }
+  free(threads);
+
+  FILE *out = stdout;
+  if(out_name){
+    out = fopen(out_name, "w");
+    if(out == NULL){
+      printf("Unable to open %s\n", out_name);
+      exit(-1);
+    }
+  }
+  print_results(&sw, out);
+  if(out != stdout){
+    fclose(out);
+  }
+
+  for(uns64 j = 0; j < sw.num_jobs; j++){
+    if(sw.jobs[j].mc){
+      multicore_delete(sw.jobs[j].mc);
+    } else {
+      memsys_delete(sw.jobs[j].sys);
+    }
+    free(sw.jobs[j].cfg.interval_file);
+    free(sw.jobs[j].cfg.hierarchy_file);
+  }
+  free(sw.jobs);
+  trace_delete(sw.trace);
+  if(sw.warmup){
+    trace_delete(sw.warmup);
+  }
+
+  return 0;
+}
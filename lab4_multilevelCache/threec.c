@@ -0,0 +1,172 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "threec.h"
+
+#define THREEC_NIL      0xffffffffu
+#define THREEC_NO_LINE  (~(Addr)0)   // empty slot of the seen set
+#define THREEC_SEEN_MIN 4096
+
+static uns64 threec_hash(Addr lineaddr){
+  return (lineaddr * 0x9e3779b97f4a7c15ULL) >> 20;
+}
+
+////////////////////////////////////////////////////////////////////
+// Both tables are sized to powers of two: the shadow's at twice its
+// lines, so chains stay short; the seen set grows as lines come in
+////////////////////////////////////////////////////////////////////
+
+Three_C *threec_new(uns64 num_lines){
+  if(num_lines == 0 || num_lines >= THREEC_NIL){
+    printf("Three-C classification needs 1 to %u lines\n", THREEC_NIL - 1);
+    exit(-1);
+  }
+
+  Three_C *t = (Three_C *) calloc (1, sizeof (Three_C));
+  t->num_lines = num_lines;
+  t->line = (Three_C_Line *) calloc (num_lines, sizeof(Three_C_Line));
+  t->mru = t->lru = THREEC_NIL;
+
+  uns64 buckets = 1;
+  while(buckets < 2 * num_lines){
+    buckets <<= 1;
+  }
+  t->bucket_mask = buckets - 1;
+  t->bucket = (uns32 *) malloc (buckets * sizeof(uns32));
+  memset(t->bucket, 0xff, buckets * sizeof(uns32)); // every head starts as THREEC_NIL
+
+  t->seen_mask = THREEC_SEEN_MIN - 1;
+  t->seen = (Addr *) malloc (THREEC_SEEN_MIN * sizeof(Addr));
+  memset(t->seen, 0xff, THREEC_SEEN_MIN * sizeof(Addr));
+
+  return t;
+}
+
+void threec_delete(Three_C *t){
+  free(t->seen);
+  free(t->bucket);
+  free(t->line);
+  free(t);
+}
+
+////////////////////////////////////////////////////////////////////
+// Seen set: linear probing, doubled when half full
+////////////////////////////////////////////////////////////////////
+
+static Addr *threec_seen_slot(Addr *seen, uns64 mask, Addr lineaddr){
+  uns64 i = threec_hash(lineaddr) & mask;
+  while(seen[i] != lineaddr && seen[i] != THREEC_NO_LINE){
+    i = (i + 1) & mask;
+  }
+  return &seen[i];
+}
+
+static void threec_seen_grow(Three_C *t){
+  uns64 size = 2 * (t->seen_mask + 1);
+  Addr *seen = (Addr *) malloc (size * sizeof(Addr));
+  memset(seen, 0xff, size * sizeof(Addr));
+  for(uns64 i = 0; i <= t->seen_mask; i++){
+    if(t->seen[i] != THREEC_NO_LINE){
+      *threec_seen_slot(seen, size - 1, t->seen[i]) = t->seen[i];
+    }
+  }
+  free(t->seen);
+  t->seen = seen;
+  t->seen_mask = size - 1;
+}
+
+// Returns TRUE the first time lineaddr is seen
+static Flag threec_first_touch(Three_C *t, Addr lineaddr){
+  Addr *slot = threec_seen_slot(t->seen, t->seen_mask, lineaddr);
+  if(*slot == lineaddr){
+    return FALSE;
+  }
+  *slot = lineaddr;
+  t->seen_count++;
+  if(2 * t->seen_count > t->seen_mask + 1){
+    threec_seen_grow(t);
+  }
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////
+// Shadow cache: LRU list and hash chains through the same lines
+////////////////////////////////////////////////////////////////////
+
+static void threec_unlink(Three_C *t, uns32 i){
+  Three_C_Line *l = &t->line[i];
+  if(l->prev != THREEC_NIL){
+    t->line[l->prev].next = l->next;
+  } else {
+    t->mru = l->next;
+  }
+  if(l->next != THREEC_NIL){
+    t->line[l->next].prev = l->prev;
+  } else {
+    t->lru = l->prev;
+  }
+}
+
+static void threec_push_mru(Three_C *t, uns32 i){
+  Three_C_Line *l = &t->line[i];
+  l->prev = THREEC_NIL;
+  l->next = t->mru;
+  if(t->mru != THREEC_NIL){
+    t->line[t->mru].prev = i;
+  } else {
+    t->lru = i;
+  }
+  t->mru = i;
+}
+
+static void threec_unchain(Three_C *t, uns32 i){
+  uns32 *p = &t->bucket[threec_hash(t->line[i].lineaddr) & t->bucket_mask];
+  while(*p != i){
+    p = &t->line[*p].chain;
+  }
+  *p = t->line[i].chain;
+}
+
+// Returns TRUE on a hit; either way lineaddr ends up MRU
+static Flag threec_shadow_access(Three_C *t, Addr lineaddr){
+  uns32 *head = &t->bucket[threec_hash(lineaddr) & t->bucket_mask];
+  for(uns32 i = *head; i != THREEC_NIL; i = t->line[i].chain){
+    if(t->line[i].lineaddr == lineaddr){
+      if(t->mru != i){
+        threec_unlink(t, i);
+        threec_push_mru(t, i);
+      }
+      return TRUE;
+    }
+  }
+
+  uns32 i;
+  if(t->used < t->num_lines){
+    i = t->used++;
+  } else {
+    i = t->lru;
+    threec_unlink(t, i);
+    threec_unchain(t, i);
+  }
+  t->line[i].lineaddr = lineaddr;
+  t->line[i].chain = *head;
+  *head = i;
+  threec_push_mru(t, i);
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////
+// Called on every demand access. Returns what a miss to lineaddr in
+// the real cache would be; the caller counts it only if it missed.
+////////////////////////////////////////////////////////////////////
+
+Three_C_Class threec_access(Three_C *t, Addr lineaddr){
+  // a line in the shadow cache has been seen, so only shadow misses
+  // need the seen set
+  if(threec_shadow_access(t, lineaddr)){
+    return THREEC_CONFLICT;
+  }
+  return threec_first_touch(t, lineaddr) ? THREEC_COMPULSORY : THREEC_CAPACITY;
+}
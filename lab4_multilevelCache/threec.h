@@ -0,0 +1,58 @@
+#ifndef THREEC_H
+#define THREEC_H
+
+#include "types.h"
+
+typedef struct Three_C Three_C;
+typedef struct Three_C_Line Three_C_Line;
+
+//////////////////////////////////////////////////////////////////
+// Three-C miss classification for one cache (cache_enable_threec).
+//
+// Every demand access to the cache is also run through a set of
+// every line ever touched and a shadow fully-associative LRU cache
+// with the same number of lines. A miss in the real cache is
+//  - compulsory: the line was never touched before
+//  - capacity:   the shadow cache misses too
+//  - conflict:   the shadow cache hits, only the mapping is to blame
+//  - sector:     a sectored cache had the line but not the sector;
+//                counted by the cache, threec_access never returns it
+//
+// The shadow cache is a hash table over a pool of lines that are
+// also linked in LRU order, so an access is O(1) whatever the size.
+//////////////////////////////////////////////////////////////////
+
+typedef enum Three_C_Class_Enum {
+  THREEC_COMPULSORY,
+  THREEC_CAPACITY,
+  THREEC_CONFLICT,
+  THREEC_SECTOR,
+  NUM_THREEC_CLASSES
+} Three_C_Class;
+
+struct Three_C_Line {
+  Addr  lineaddr;
+  uns32 prev;   // towards MRU
+  uns32 next;   // towards LRU
+  uns32 chain;  // next line in the same hash bucket
+};
+
+struct Three_C {
+  uns64 num_lines;
+  uns64 used;
+  Three_C_Line *line;  // shadow cache lines, indexed by uns32
+  uns32 *bucket;       // hash bucket heads
+  uns64  bucket_mask;
+  uns32  mru;
+  uns32  lru;
+
+  Addr  *seen;         // open-addressing set of every line touched
+  uns64  seen_mask;
+  uns64  seen_count;
+};
+
+Three_C      *threec_new(uns64 num_lines);
+void          threec_delete(Three_C *t);
+Three_C_Class threec_access(Three_C *t, Addr lineaddr);
+
+#endif // THREEC_H
@@ -0,0 +1,167 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tlb.h"
+#include "repl.h"
+
+#define TLB_VPN_BITS    36  // 48-bit virtual addresses of 4KB pages
+#define TLB_LEVEL_BITS  9   // 512 PTEs per table
+
+////////////////////////////////////////////////////////////////////
+// Defaults: 4KB pages, a 128-entry 8-way ITLB, a 64-entry 4-way DTLB
+// and a 1536-entry 12-way L2 TLB 7 cycles away
+////////////////////////////////////////////////////////////////////
+
+void tlb_config_default(TLB_Config *cfg){
+  memset(cfg, 0, sizeof(TLB_Config));
+  cfg->page_size = TLB_PAGE_4KB;
+  cfg->itlb_entries = 128;
+  cfg->itlb_assoc = 8;
+  cfg->dtlb_entries = 64;
+  cfg->dtlb_assoc = 4;
+  cfg->stlb_entries = 1536;
+  cfg->stlb_assoc = 12;
+  cfg->stlb_latency = 7;
+}
+
+TLB *tlb_new(TLB_Config *cfg){
+  if(cfg->page_size != TLB_PAGE_4KB && cfg->page_size != TLB_PAGE_2MB){
+    printf("TLB page size must be 4KB or 2MB\n");
+    exit(-1);
+  }
+  if(cfg->itlb_entries == 0 || cfg->dtlb_entries == 0){
+    printf("The L1 TLBs need at least one entry\n");
+    exit(-1);
+  }
+
+  TLB *t = (TLB *) calloc (1, sizeof (TLB));
+  t->cfg = *cfg;
+  t->page_shift = (cfg->page_size == TLB_PAGE_2MB) ? 21 : 12;
+  // a TLB entry is a one-byte line whose address is the page number
+  t->itlb = cache_new(cfg->itlb_entries, cfg->itlb_assoc, 1, REPL_LRU);
+  t->dtlb = cache_new(cfg->dtlb_entries, cfg->dtlb_assoc, 1, REPL_LRU);
+  if(cfg->stlb_entries){
+    t->stlb = cache_new(cfg->stlb_entries, cfg->stlb_assoc, 1, REPL_LRU);
+  }
+  return t;
+}
+
+void tlb_delete(TLB *t){
+  cache_delete(t->itlb);
+  cache_delete(t->dtlb);
+  if(t->stlb){
+    cache_delete(t->stlb);
+  }
+  free(t);
+}
+
+////////////////////////////////////////////////////////////////////
+// Look vpn up in one TLB, filling it on a miss. Functional lookups
+// only update the entries and replacement state.
+////////////////////////////////////////////////////////////////////
+
+static Flag tlb_lookup(Cache *c, Addr vpn, Flag functional){
+  if(functional){
+    return cache_warm(c, vpn, 0, FALSE);
+  }
+  if(cache_access(c, vpn, FALSE) == HIT){
+    return HIT;
+  }
+  cache_install(c, vpn, FALSE);
+  return MISS;
+}
+
+static Flag tlb_translate(TLB *t, Addr addr, Access_Type type, Flag functional, uns64 *delay){
+  Addr vpn = addr >> t->page_shift;
+  Cache *l1 = (type == ACCESS_TYPE_IFETCH) ? t->itlb : t->dtlb;
+
+  *delay = 0;
+  if(tlb_lookup(l1, vpn, functional) == HIT){
+    return HIT;
+  }
+  if(t->stlb){
+    *delay = t->cfg.stlb_latency;
+    if(tlb_lookup(t->stlb, vpn, functional) == HIT){
+      return HIT;
+    }
+  }
+  return MISS;
+}
+
+// Returns MISS when addr needs a page walk; *delay is the L2 TLB
+// latency paid on the way, if any. The walk itself is the caller's.
+Flag tlb_access(TLB *t, Addr addr, Access_Type type, uns64 *delay){
+  Flag outcome = tlb_translate(t, addr, type, FALSE, delay);
+  t->stat_delay += *delay;
+  if(outcome == MISS){
+    t->stat_walks++;
+  }
+  return outcome;
+}
+
+Flag tlb_warm(TLB *t, Addr addr, Access_Type type){
+  uns64 delay;
+  return tlb_translate(t, addr, type, TRUE, &delay);
+}
+
+////////////////////////////////////////////////////////////////////
+// The PTE addresses a walk for addr loads, root first; returns how
+// many. Level L's entry for a page is at its base plus the page's
+// 4KB page number shifted right by 9*L, times the PTE size.
+////////////////////////////////////////////////////////////////////
+
+uns tlb_walk_addrs(TLB *t, Addr addr, Addr *pte_addrs){
+  Addr vpn = (addr >> 12) & ((1ULL << TLB_VPN_BITS) - 1);
+  uns leaf = (t->page_shift - 12) / TLB_LEVEL_BITS;  // 2MB pages stop a level early
+  uns n = 0;
+
+  for(int level = TLB_MAX_LEVELS - 1; level >= (int) leaf; level--){
+    pte_addrs[n++] = TLB_TABLE_BASE + level * TLB_LEVEL_SPAN
+                     + (vpn >> (level * TLB_LEVEL_BITS)) * TLB_PTE_BYTES;
+  }
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void tlb_clear_stats(TLB *t){
+  cache_clear_stats(t->itlb);
+  cache_clear_stats(t->dtlb);
+  if(t->stlb){
+    cache_clear_stats(t->stlb);
+  }
+  t->stat_walks = 0;
+  t->stat_walk_accesses = 0;
+  t->stat_walk_delay = 0;
+  t->stat_delay = 0;
+}
+
+void tlb_print_stats(TLB *t, char *header){
+  double walk_delay_avg = 0;
+
+  if(t->stat_walks){
+    walk_delay_avg = (double)(t->stat_walk_delay)/(double)(t->stat_walks);
+  }
+
+  printf("\n%s_PAGE_SIZE      \t\t : %10llu", header, t->cfg.page_size);
+  printf("\n%s_DTLB_REACH_KB  \t\t : %10llu", header, t->cfg.dtlb_entries * t->cfg.page_size / 1024);
+  if(t->stlb){
+    printf("\n%s_STLB_REACH_KB  \t\t : %10llu", header, t->cfg.stlb_entries * t->cfg.page_size / 1024);
+  }
+  printf("\n");
+
+  cache_print_stats(t->itlb, "ITLB");
+  cache_print_stats(t->dtlb, "DTLB");
+  if(t->stlb){
+    cache_print_stats(t->stlb, "STLB");
+  }
+
+  printf("\n%s_WALKS          \t\t : %10llu", header, t->stat_walks);
+  printf("\n%s_WALK_ACCESSES  \t\t : %10llu", header, t->stat_walk_accesses);
+  printf("\n%s_WALK_AVGDELAY  \t\t : %10.3f", header, walk_delay_avg);
+  printf("\n%s_DELAY          \t\t : %10llu", header, t->stat_delay);
+  printf("\n");
+}
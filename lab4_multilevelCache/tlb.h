@@ -0,0 +1,72 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include "types.h"
+#include "cache.h"
+
+typedef struct TLB_Config TLB_Config;
+typedef struct TLB        TLB;
+
+//////////////////////////////////////////////////////////////////
+// Address translation in front of the caches (modes B/C, blocking),
+// when TLB_Config.page_size is set: an instruction and a data L1 TLB,
+// optionally backed by a shared L2 TLB, and a page-table walker.
+//
+// Each TLB is a Cache of page numbers (one-byte "lines", LRU; assoc
+// 0 makes it fully associative, see cache_new_indexed()). An L1
+// TLB hit overlaps the L1 cache access and costs nothing; an L1 miss
+// that hits the L2 TLB costs stlb_latency; a miss in both starts a
+// walk of an x86-64 style radix table, four levels for 4KB pages and
+// three for 2MB ones. memsys.c sends every level's PTE load through
+// the cache hierarchy, one after the other, and the walk's delay is
+// their sum. Pages are identity-mapped, so turning translation on
+// changes the timing and adds the walk traffic, but the demand
+// accesses hit and miss in the caches as before.
+//
+// Each level of the table is laid out linearly from its own base
+// (tlb_walk_addrs), so neighbouring pages share PTE lines the way
+// they do in a real page table.
+//////////////////////////////////////////////////////////////////
+
+#define TLB_PAGE_4KB      (4*1024)
+#define TLB_PAGE_2MB      (2*1024*1024)
+#define TLB_MAX_LEVELS    4
+#define TLB_PTE_BYTES     8
+#define TLB_TABLE_BASE    0xffff000000000000ULL  // page tables, above any trace address
+#define TLB_LEVEL_SPAN    (1ULL << 44)           // bytes of table space per level
+
+struct TLB_Config {
+  uns64 page_size;      // 0 = no translation, else TLB_PAGE_4KB or TLB_PAGE_2MB
+  uns64 itlb_entries;
+  uns64 itlb_assoc;
+  uns64 dtlb_entries;
+  uns64 dtlb_assoc;
+  uns64 stlb_entries;   // shared L2 TLB, 0 = none
+  uns64 stlb_assoc;
+  uns64 stlb_latency;   // cycles an L1 TLB miss that hits the L2 TLB adds
+};
+
+struct TLB {
+  TLB_Config cfg;
+  uns64 page_shift;
+  Cache *itlb;
+  Cache *dtlb;
+  Cache *stlb;          // NULL when cfg.stlb_entries is 0
+
+  //stats
+  uns64 stat_walks;
+  uns64 stat_walk_accesses; // PTE loads sent to the caches
+  uns64 stat_walk_delay;
+  uns64 stat_delay;         // all translation delay, L2 TLB hits and walks
+};
+
+void  tlb_config_default(TLB_Config *cfg);
+TLB  *tlb_new(TLB_Config *cfg);
+void  tlb_delete(TLB *t);
+Flag  tlb_access(TLB *t, Addr addr, Access_Type type, uns64 *delay);
+Flag  tlb_warm(TLB *t, Addr addr, Access_Type type);
+uns   tlb_walk_addrs(TLB *t, Addr addr, Addr *pte_addrs);
+void  tlb_clear_stats(TLB *t);
+void  tlb_print_stats(TLB *t, char *header);
+
+#endif // TLB_H
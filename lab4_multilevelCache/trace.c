@@ -0,0 +1,206 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+#define TRACE_INITIAL_RECS (1 << 20)
+
+////////////////////////////////////////////////////////////////////
+// Binary trace: map the file and point recs/pcs into it
+////////////////////////////////////////////////////////////////////
+
+static Trace *trace_map(char *filename, int fd, uns64 bytes){
+  void *map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(map == MAP_FAILED){
+    printf("Unable to map trace file %s\n", filename);
+    exit(-1);
+  }
+  madvise(map, bytes, MADV_SEQUENTIAL);
+
+  Trace_File_Header *hdr = (Trace_File_Header *) map;
+  uns64 words = (hdr->flags & TRACE_HAS_PC) ? 2 : 1;
+  uns64 core_bytes = (hdr->flags & TRACE_HAS_CORE) ? (hdr->num_recs + 7) / 8 * 8 : 0;
+  if(hdr->version != TRACE_VERSION
+     || bytes != sizeof(Trace_File_Header) + words * hdr->num_recs * sizeof(uns64) + core_bytes){
+    printf("Bad binary trace file %s\n", filename);
+    exit(-1);
+  }
+
+  Trace *t = (Trace *) calloc (1, sizeof (Trace));
+  t->num_recs = hdr->num_recs;
+  t->recs = (Trace_Rec *) (hdr + 1);
+  if(hdr->flags & TRACE_HAS_PC){
+    t->pcs = (Addr *) (t->recs + t->num_recs);
+  }
+  if(hdr->flags & TRACE_HAS_CORE){
+    t->cores = (uns8 *) (t->recs + words * t->num_recs);
+  }
+  t->map = map;
+  t->map_bytes = bytes;
+  return t;
+}
+
+////////////////////////////////////////////////////////////////////
+// Text trace: parse into malloced arrays
+////////////////////////////////////////////////////////////////////
+
+static Trace *trace_parse(char *filename){
+  FILE *fp = fopen(filename, "r");
+  if(fp == NULL){
+    printf("Unable to open trace file %s\n", filename);
+    exit(-1);
+  }
+
+  Trace *t = (Trace *) calloc (1, sizeof (Trace));
+  uns64 max_recs = TRACE_INITIAL_RECS;
+  t->recs = (Trace_Rec *) malloc (max_recs * sizeof(Trace_Rec));
+
+  char line[256];
+  uns64 lineno = 0;
+  while(fgets(line, sizeof(line), fp)){
+    lineno++;
+    char *p = line;
+    while(*p == ' ' || *p == '\t'){
+      p++;
+    }
+    if(*p == '\n' || *p == '\0' || *p == '#'){
+      continue;
+    }
+
+    // the first record decides whether the trace carries core tags,
+    // the rest must agree with it
+    Flag has_core = (*p == 'c');
+    unsigned long core = 0;
+    if(t->num_recs && has_core != (t->cores != NULL)){
+      printf("Bad trace record at %s:%llu\n", filename, lineno);
+      exit(-1);
+    }
+    if(has_core){
+      char *core_end;
+      core = strtoul(p + 1, &core_end, 10);
+      if(core_end == p + 1 || core >= TRACE_MAX_CORES){
+        printf("Bad trace record at %s:%llu\n", filename, lineno);
+        exit(-1);
+      }
+      p = core_end;
+    }
+
+    char *type_end, *addr_end, *pc_end;
+    unsigned long type = strtoul(p, &type_end, 10);
+    Addr addr = strtoull(type_end, &addr_end, 16);
+    Addr pc = strtoull(addr_end, &pc_end, 16);
+    Flag has_pc = (pc_end != addr_end);
+    // the first record decides whether the trace carries PCs, the
+    // rest must agree with it
+    if(type_end == p || addr_end == type_end || type >= NUM_ACCESS_TYPES
+       || (addr >> (64 - TRACE_TYPE_BITS)) || (t->num_recs && has_pc != (t->pcs != NULL))){
+      printf("Bad trace record at %s:%llu\n", filename, lineno);
+      exit(-1);
+    }
+
+    if(t->num_recs == max_recs){
+      max_recs *= 2;
+      t->recs = (Trace_Rec *) realloc (t->recs, max_recs * sizeof(Trace_Rec));
+      if(t->pcs){
+        t->pcs = (Addr *) realloc (t->pcs, max_recs * sizeof(Addr));
+      }
+      if(t->cores){
+        t->cores = (uns8 *) realloc (t->cores, max_recs);
+      }
+    }
+    if(t->num_recs == 0 && has_pc){
+      t->pcs = (Addr *) malloc (max_recs * sizeof(Addr));
+    }
+    if(t->num_recs == 0 && has_core){
+      t->cores = (uns8 *) malloc (max_recs);
+    }
+    t->recs[t->num_recs] = trace_rec(addr, (Access_Type) type);
+    if(t->pcs){
+      t->pcs[t->num_recs] = pc;
+    }
+    if(t->cores){
+      t->cores[t->num_recs] = core;
+    }
+    t->num_recs++;
+  }
+
+  fclose(fp);
+  return t;
+}
+
+////////////////////////////////////////////////////////////////////
+// Binary traces are recognised by their magic, anything else is text
+////////////////////////////////////////////////////////////////////
+
+Trace *trace_load(char *filename){
+  int fd = open(filename, O_RDONLY);
+  if(fd < 0){
+    printf("Unable to open trace file %s\n", filename);
+    exit(-1);
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+
+  char magic[sizeof(((Trace_File_Header *) 0)->magic)];
+  Flag binary = st.st_size >= (off_t) sizeof(Trace_File_Header)
+                && read(fd, magic, sizeof(magic)) == sizeof(magic)
+                && !memcmp(magic, TRACE_MAGIC, sizeof(magic));
+
+  Trace *t = binary ? trace_map(filename, fd, st.st_size) : trace_parse(filename);
+  close(fd);
+  return t;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void trace_write(Trace *t, char *filename){
+  FILE *fp = fopen(filename, "wb");
+  if(fp == NULL){
+    printf("Unable to open %s\n", filename);
+    exit(-1);
+  }
+
+  Trace_File_Header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+  hdr.version = TRACE_VERSION;
+  hdr.num_recs = t->num_recs;
+  hdr.flags = (t->pcs ? TRACE_HAS_PC : 0) | (t->cores ? TRACE_HAS_CORE : 0);
+
+  Flag ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+            && fwrite(t->recs, sizeof(Trace_Rec), t->num_recs, fp) == t->num_recs;
+  if(ok && t->pcs){
+    ok = fwrite(t->pcs, sizeof(Addr), t->num_recs, fp) == t->num_recs;
+  }
+  if(ok && t->cores){
+    uns64 pad = (t->num_recs + 7) / 8 * 8 - t->num_recs;
+    ok = fwrite(t->cores, 1, t->num_recs, fp) == t->num_recs
+         && fwrite("\0\0\0\0\0\0\0", 1, pad, fp) == pad;
+  }
+  if(fclose(fp) != 0 || !ok){
+    printf("Error writing %s\n", filename);
+    exit(-1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void trace_delete(Trace *t){
+  if(t->map){
+    munmap(t->map, t->map_bytes);
+  } else {
+    free(t->recs);
+    free(t->pcs);
+    free(t->cores);
+  }
+  free(t);
+}
@@ -0,0 +1,68 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+
+typedef uns64            Trace_Rec;
+typedef struct Trace     Trace;
+
+//////////////////////////////////////////////////////////////////
+// A whole trace held in memory, so it can be parsed once and then
+// replayed (read-only) by any number of memory systems.
+//
+// Text format: one access per line, "[c<core>] <type> <address in
+// hex> [pc]", type 0 = IFETCH, 1 = LOAD, 2 = STORE, optional PC in
+// hex, given on every line or on none. Multi-threaded traces tag
+// every access with the core that made it, e.g. "c3 1 7fff5a10".
+// Blank lines and lines starting with '#' are skipped.
+//
+// Binary format (tracecvt converts text to it): a Trace_File_Header,
+// then num_recs fixed-width Trace_Rec words, then, if TRACE_HAS_PC,
+// num_recs PCs, then, if TRACE_HAS_CORE, num_recs one-byte core IDs
+// padded to a multiple of 8 bytes. Words are host-endian. A binary trace is mmapped
+// and its records are used in place, with no parsing or copying.
+//////////////////////////////////////////////////////////////////
+
+// A record packs the access type into the low bits of the address
+#define TRACE_TYPE_BITS 2
+
+#define TRACE_MAGIC   "LC4TRACE"
+#define TRACE_VERSION 1
+#define TRACE_HAS_PC   0x1
+#define TRACE_HAS_CORE 0x2
+#define TRACE_MAX_CORES 256
+
+typedef struct Trace_File_Header {
+  char  magic[8];
+  uns64 version;
+  uns64 num_recs;
+  uns64 flags;
+} Trace_File_Header;
+
+struct Trace {
+  uns64      num_recs;
+  Trace_Rec *recs;
+  Addr      *pcs;       // NULL unless the trace has PCs
+  uns8      *cores;     // NULL unless the trace has core IDs
+
+  void      *map;       // the mmapped file, NULL for a text trace
+  uns64      map_bytes;
+};
+
+static inline Trace_Rec trace_rec(Addr addr, Access_Type type){
+  return (addr << TRACE_TYPE_BITS) | type;
+}
+
+static inline Addr trace_rec_addr(Trace_Rec rec){
+  return rec >> TRACE_TYPE_BITS;
+}
+
+static inline Access_Type trace_rec_type(Trace_Rec rec){
+  return (Access_Type) (rec & ((1 << TRACE_TYPE_BITS) - 1));
+}
+
+Trace  *trace_load(char *filename);
+void    trace_write(Trace *t, char *filename);
+void    trace_delete(Trace *t);
+
+#endif // TRACE_H
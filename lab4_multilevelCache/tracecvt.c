@@ -0,0 +1,25 @@
+/////////////////////////////////////////////////////////////////////
+// Convert a text trace to the binary trace format (see trace.h)
+//
+// Usage: tracecvt <text trace> <binary trace>
+/////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+int main(int argc, char **argv){
+  if(argc != 3){
+    printf("Usage: %s <text trace> <binary trace>\n", argv[0]);
+    exit(-1);
+  }
+
+  Trace *t = trace_load(argv[1]);
+  trace_write(t, argv[2]);
+  printf("%llu records%s%s written to %s\n", t->num_recs, t->pcs ? " (with PC)" : "",
+         t->cores ? " (with core IDs)" : "", argv[2]);
+  trace_delete(t);
+
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "writebuf.h"
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+Write_Buffer *writebuf_new(uns64 num_entries, uns64 drain_latency){
+  Write_Buffer *wb = (Write_Buffer *) calloc (1, sizeof (Write_Buffer));
+  wb->num_entries = num_entries;
+  wb->drain_latency = drain_latency;
+  wb->lineaddr = (Addr *) calloc (num_entries, sizeof(Addr));
+  wb->done = (uns64 *) calloc (num_entries, sizeof(uns64));
+  return wb;
+}
+
+void writebuf_delete(Write_Buffer *wb){
+  free(wb->done);
+  free(wb->lineaddr);
+  free(wb);
+}
+
+// Drop the entries whose L2 write has completed by cycle now
+static void writebuf_retire(Write_Buffer *wb, uns64 now){
+  while(wb->count && wb->done[wb->head] <= now){
+    wb->head = (wb->head + 1) % wb->num_entries;
+    wb->count--;
+  }
+}
+
+static uns64 writebuf_find(Write_Buffer *wb, Addr lineaddr){
+  for(uns64 i = 0; i < wb->count; i++){
+    uns64 slot = (wb->head + i) % wb->num_entries;
+    if(wb->lineaddr[slot] == lineaddr){
+      return slot;
+    }
+  }
+  return wb->num_entries;
+}
+
+////////////////////////////////////////////////////////////////////
+// A store to lineaddr at cycle now. Returns the cycles it stalls for
+// a free entry; *merged is set if it coalesced into a buffered line
+// (and so needs no L2 write of its own).
+////////////////////////////////////////////////////////////////////
+
+uns64 writebuf_insert(Write_Buffer *wb, Addr lineaddr, uns64 now, Flag *merged){
+  writebuf_retire(wb, now);
+  wb->stat_writes++;
+
+  *merged = (writebuf_find(wb, lineaddr) < wb->num_entries);
+  if(*merged){
+    wb->stat_coalesced++;
+    return 0;
+  }
+
+  uns64 stall = 0;
+  if(wb->count == wb->num_entries){
+    stall = wb->done[wb->head] - now;
+    wb->stat_full++;
+    wb->stat_full_cycles += stall;
+    writebuf_retire(wb, now + stall);
+  }
+
+  uns64 start = now + stall;
+  if(wb->count){
+    uns64 newest = (wb->head + wb->count - 1) % wb->num_entries;
+    if(wb->done[newest] > start){
+      start = wb->done[newest];
+    }
+  }
+  uns64 slot = (wb->head + wb->count) % wb->num_entries;
+  wb->lineaddr[slot] = lineaddr;
+  wb->done[slot] = start + wb->drain_latency;
+  wb->count++;
+  return stall;
+}
+
+////////////////////////////////////////////////////////////////////
+// A read miss to lineaddr at cycle now: the cycles until a buffered
+// write to the line has reached the L2, 0 if there is none
+////////////////////////////////////////////////////////////////////
+
+uns64 writebuf_read_wait(Write_Buffer *wb, Addr lineaddr, uns64 now){
+  writebuf_retire(wb, now);
+  uns64 slot = writebuf_find(wb, lineaddr);
+  if(slot == wb->num_entries){
+    return 0;
+  }
+  uns64 wait = wb->done[slot] - now;
+  wb->stat_raw_cycles += wait;
+  return wait;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+void writebuf_clear_stats(Write_Buffer *wb){
+  wb->stat_writes = 0;
+  wb->stat_coalesced = 0;
+  wb->stat_full = 0;
+  wb->stat_full_cycles = 0;
+  wb->stat_raw_cycles = 0;
+}
+
+void writebuf_print_stats(Write_Buffer *wb, char *header){
+  printf("\n%s_WRITES         \t\t : %10llu", header, wb->stat_writes);
+  printf("\n%s_COALESCED      \t\t : %10llu", header, wb->stat_coalesced);
+  printf("\n%s_FULL           \t\t : %10llu", header, wb->stat_full);
+  printf("\n%s_FULL_CYCLES    \t\t : %10llu", header, wb->stat_full_cycles);
+  printf("\n%s_RAW_CYCLES     \t\t : %10llu", header, wb->stat_raw_cycles);
+  printf("\n");
+}
@@ -0,0 +1,43 @@
+#ifndef WRITEBUF_H
+#define WRITEBUF_H
+
+#include "types.h"
+
+typedef struct Write_Buffer Write_Buffer;
+
+//////////////////////////////////////////////////////////////////
+// Coalescing write buffer between the DCACHE and the L2, for stores
+// that do not stay in the DCACHE (write-through, write-no-allocate).
+//
+// Entries drain to the L2 in FIFO order, one every drain_latency
+// cycles, so a store only waits when the buffer is full. A store to a
+// line that is still buffered merges into its entry. The caller does
+// the L2 write itself when an entry is created, so the buffer only
+// decides timing; a read miss to a buffered line waits for its entry
+// to drain before going to the L2.
+//////////////////////////////////////////////////////////////////
+
+struct Write_Buffer {
+  uns64  num_entries;
+  uns64  drain_latency;
+  Addr  *lineaddr;  // ring of entries, oldest at head
+  uns64 *done;      // cycle each entry's L2 write completes
+  uns64  head;
+  uns64  count;
+
+  //stats
+  uns64 stat_writes;
+  uns64 stat_coalesced;    // stores merged into a buffered line
+  uns64 stat_full;         // stores that waited for a free entry
+  uns64 stat_full_cycles;
+  uns64 stat_raw_cycles;   // read misses waiting for a buffered line
+};
+
+Write_Buffer *writebuf_new(uns64 num_entries, uns64 drain_latency);
+void          writebuf_delete(Write_Buffer *wb);
+uns64         writebuf_insert(Write_Buffer *wb, Addr lineaddr, uns64 now, Flag *merged);
+uns64         writebuf_read_wait(Write_Buffer *wb, Addr lineaddr, uns64 now);
+void          writebuf_clear_stats(Write_Buffer *wb);
+void          writebuf_print_stats(Write_Buffer *wb, char *header);
+
+#endif // WRITEBUF_H